@@ -0,0 +1,109 @@
+// Offline motion to photon measurement : a video (high frame rate if possible) films a blinking led
+// and the screen of "./AR --latency", whose top right square lights up when the camera sees the led lit.
+// The latency is the delay between the led and the square switching on.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+using namespace cv;
+using namespace std;
+
+static void help()
+{
+    cout << "Usage: latency video ledX ledY screenX screenY [radius]" << endl
+         << "ledX ledY : led position in the video, screenX screenY : center of the square on the filmed screen" << endl;
+}
+
+// times (in frames, interpolated) where the signal rises above the middle of its range
+static vector<double> risingEdges(const vector<double>& signal)
+{
+    vector<double> edges;
+    if(signal.empty())
+        return edges;
+
+    double low = *min_element(signal.begin(), signal.end());
+    double high = *max_element(signal.begin(), signal.end());
+    double threshold = (low + high) / 2;
+
+    for(size_t i = 1; i < signal.size(); ++i)
+        if(signal[i - 1] < threshold && signal[i] >= threshold)
+            edges.push_back(i - 1 + (threshold - signal[i - 1]) / (signal[i] - signal[i - 1]));
+    return edges;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 6) {
+        help();
+        return 1;
+    }
+
+    VideoCapture video(argv[1]);
+    if(!video.isOpened()) {
+        cout << "can't open " << argv[1] << endl;
+        return 1;
+    }
+
+    Point led(atoi(argv[2]), atoi(argv[3]));
+    Point screen(atoi(argv[4]), atoi(argv[5]));
+    int radius = argc > 6 ? atoi(argv[6]) : 8;
+
+    double fps = video.get(CV_CAP_PROP_FPS);
+    if(fps <= 0)
+        fps = 30;
+
+    // brightness of the led and of the square, frame by frame
+    vector<double> ledSignal, screenSignal;
+    Mat frame, gray;
+    while(video.read(frame)) {
+        cvtColor(frame, gray, COLOR_BGR2GRAY);
+        Rect full(0, 0, gray.cols, gray.rows);
+        Rect ledRoi = Rect(led.x - radius, led.y - radius, 2 * radius + 1, 2 * radius + 1) & full;
+        Rect screenRoi = Rect(screen.x - radius, screen.y - radius, 2 * radius + 1, 2 * radius + 1) & full;
+        if(ledRoi.area() == 0 || screenRoi.area() == 0) {
+            cout << "positions outside of the " << gray.cols << "x" << gray.rows << " video" << endl;
+            return 1;
+        }
+
+        ledSignal.push_back(mean(gray(ledRoi))[0]);
+        screenSignal.push_back(mean(gray(screenRoi))[0]);
+    }
+
+    vector<double> ledEdges = risingEdges(ledSignal);
+    vector<double> screenEdges = risingEdges(screenSignal);
+
+    // each led edge with the first screen edge before the next led edge
+    vector<double> latencies;
+    size_t s = 0;
+    for(size_t i = 0; i < ledEdges.size(); ++i) {
+        double next = i + 1 < ledEdges.size() ? ledEdges[i + 1] : ledSignal.size();
+        while(s < screenEdges.size() && screenEdges[s] < ledEdges[i])
+            s++;
+        if(s == screenEdges.size() || screenEdges[s] >= next)
+            continue; // missed blink
+
+        double ms = (screenEdges[s] - ledEdges[i]) * 1000.0 / fps;
+        latencies.push_back(ms);
+        cout << "frame " << ledEdges[i] << " : " << ms << " ms" << endl;
+    }
+
+    cout << ledSignal.size() << " frames at " << fps << " fps, " << ledEdges.size() << " blinks, " << latencies.size() << " measured" << endl;
+    if(latencies.empty())
+        return 1;
+
+    sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for(double l : latencies)
+        sum += l;
+    cout << "latency : mean " << sum / latencies.size() << " ms, median " << latencies[latencies.size() / 2]
+         << " ms, min " << latencies.front() << " ms, max " << latencies.back() << " ms" << endl;
+    cout << "(resolution of the video : " << 1000.0 / fps << " ms)" << endl;
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Before / after Mesh::optimize() on .obj files : vertices, indices, post transform cache misses per triangle (acmr),
+// vertex and index buffer sizes, load and optimisation times. No window or gl context needed.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <mesh.h>
+#include <mesh_optimize.h>
+#include <vertex_format.h>
+#include <wavefront.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static float elapsed(Clock::time_point start, Clock::time_point stop) {
+    return std::chrono::duration<float, std::milli>(stop - start).count();
+}
+
+struct Report {
+    int vertices;
+    int indices;
+    float acmr;
+    size_t vertexBytes;
+    size_t indexBytes;
+};
+
+static Report report(const Mesh& mesh, const VertexFormat& format, bool shortIndices) {
+    Report r;
+    r.vertices = mesh.vertex_count();
+    r.indices = mesh.index_count();
+
+    std::vector<unsigned int> indices = mesh.indices();
+    if(indices.empty()) {
+        indices.resize(mesh.vertex_count());
+        for(unsigned int i = 0; i < indices.size(); ++i)
+            indices[i] = i;
+    }
+    r.acmr = vertex_cache_acmr(indices, mesh.vertex_count());
+
+    VertexFormat used = vertex_format_used(format,
+        mesh.texcoords().size() == mesh.positions().size(),
+        mesh.normals().size() == mesh.positions().size(),
+        mesh.colors().size() == mesh.positions().size());
+    r.vertexBytes = size_t(used.stride()) * r.vertices;
+    r.indexBytes = size_t(r.indices) * (shortIndices && r.vertices <= 65536 ? 2 : 4);
+    return r;
+}
+
+static void print(const char* name, const Report& r) {
+    printf("  %-10s %8d vertices %8d indices  acmr %.3f  vertex buffer %9zu bytes  index buffer %9zu bytes\n",
+           name, r.vertices, r.indices, r.acmr, r.vertexBytes, r.indexBytes);
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i)
+        files.push_back(argv[i]);
+    if(files.empty()) {
+        files.push_back("Test/cube.obj");
+        files.push_back("Test/floor.obj");
+    }
+
+    for(size_t i = 0; i < files.size(); ++i) {
+        Clock::time_point start = Clock::now();
+        Mesh mesh = read_mesh(files[i].c_str());
+        Clock::time_point loaded = Clock::now();
+        if(mesh == Mesh::error())
+            continue;
+
+        // read_mesh : 1 vertex per triangle corner, no indices. same vertex format before and after, only the gain of optimize()
+        Report before = report(mesh, mesh.vertex_format(), false);
+
+        Clock::time_point optimizing = Clock::now();
+        mesh.optimize();
+        Clock::time_point optimized = Clock::now();
+
+        Report after = report(mesh, mesh.vertex_format(), true);
+
+        printf("%s : %d triangles, read %.2fms, optimize %.2fms\n", files[i].c_str(), mesh.triangle_count(),
+               elapsed(start, loaded), elapsed(optimizing, optimized));
+        print("before", before);
+        print("after", after);
+        printf("  memory %.2fx smaller\n", double(before.vertexBytes + before.indexBytes) / double(after.vertexBytes + after.indexBytes));
+
+        // no gl context, no buffers to release
+        mesh.release();
+    }
+
+    return 0;
+}
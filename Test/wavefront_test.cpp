@@ -0,0 +1,218 @@
+// read_mesh() against the previous line by line parser, on a generated .obj : several chunks, negative indices,
+// faces with and without texcoords / normals, materials. Also checks the binary cache written next to the file.
+// No window or gl context needed. Returns 0 if both meshes are identical.
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <mesh.h>
+#include <wavefront.h>
+
+// previous read_mesh(), fgets + sscanf, without mtllib : the generated file has no .mtl
+static Mesh readMeshReference(const char* filename) {
+    FILE* in = fopen(filename, "rt");
+    if(in == NULL)
+        return Mesh::error();
+
+    Mesh data(GL_TRIANGLES);
+
+    std::vector<vec3> positions;
+    std::vector<vec2> texcoords;
+    std::vector<vec3> normals;
+    int defaultMaterial = -1;
+
+    std::vector<int> idp;
+    std::vector<int> idt;
+    std::vector<int> idn;
+
+    char buffer[1024];
+    while(fgets(buffer, sizeof(buffer), in) != NULL) {
+        buffer[sizeof(buffer) - 1] = 0;
+
+        char* line = buffer;
+        while(*line && isspace(*line))
+            line++;
+
+        if(line[0] == 'v') {
+            float x, y, z;
+            if(line[1] == ' ') {
+                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
+                    break;
+                positions.push_back(vec3(x, y, z));
+            }
+            else if(line[1] == 'n') {
+                if(sscanf(line, "vn %f %f %f", &x, &y, &z) != 3)
+                    break;
+                normals.push_back(vec3(x, y, z));
+            }
+            else if(line[1] == 't') {
+                if(sscanf(line, "vt %f %f", &x, &y) != 2)
+                    break;
+                texcoords.push_back(vec2(x, y));
+            }
+        }
+        else if(line[0] == 'f') {
+            idp.clear();
+            idt.clear();
+            idn.clear();
+
+            int next;
+            for(line = line + 1; ; line = line + next) {
+                idp.push_back(0);
+                idt.push_back(0);
+                idn.push_back(0);
+
+                next = 0;
+                if(sscanf(line, " %d/%d/%d %n", &idp.back(), &idt.back(), &idn.back(), &next) == 3)
+                    continue;
+                else if(sscanf(line, " %d/%d %n", &idp.back(), &idt.back(), &next) == 2)
+                    continue;
+                else if(sscanf(line, " %d//%d %n", &idp.back(), &idn.back(), &next) == 2)
+                    continue;
+                else if(sscanf(line, " %d %n", &idp.back(), &next) == 1)
+                    continue;
+                else if(next == 0)
+                    break;
+            }
+
+            for(int v = 2; v + 1 < (int) idp.size(); v++) {
+                int idv[3] = { 0, v - 1, v };
+                for(int i = 0; i < 3; i++) {
+                    int k = idv[i];
+                    int p = (idp[k] < 0) ? (int) positions.size() + idp[k] : idp[k] - 1;
+                    int t = (idt[k] < 0) ? (int) texcoords.size() + idt[k] : idt[k] - 1;
+                    int n = (idn[k] < 0) ? (int) normals.size() + idn[k] : idn[k] - 1;
+
+                    if(p < 0) break;
+                    if(t >= 0) data.texcoord(texcoords[t]);
+                    if(n >= 0) data.normal(normals[n]);
+                    data.vertex(positions[p]);
+                }
+            }
+        }
+        else if(line[0] == 'u') {
+            char name[1024];
+            if(sscanf(line, "usemtl %[^\r\n]", name) == 1) {
+                // no material library, every name uses the default material
+                if(defaultMaterial == -1)
+                    defaultMaterial = data.mesh_material(Material());
+                data.material(defaultMaterial);
+            }
+        }
+    }
+
+    fclose(in);
+    return data;
+}
+
+// a few MB : 1 chunk per thread, some faces reference the vertices of the previous chunk with negative indices.
+static bool writeObj(const char* filename) {
+    FILE* out = fopen(filename, "wt");
+    if(out == NULL)
+        return false;
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> value(-1000.f, 1000.f);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    const char* formats[] = { "%f", "%.9g", "%e", "%.3E", "%.17g" };
+
+    fprintf(out, "# wavefront_test\n");
+    int positions = 0, texcoords = 0, normals = 0;
+    for(int block = 0; block < 1500; block++) {
+        for(int i = 0; i < 40; i++) {
+            const char* f = formats[rng() % 5];
+            std::string line = std::string("v ") + f + " " + f + " " + f + "\n";
+            fprintf(out, line.c_str(), value(rng), value(rng) * 1e-3f, value(rng) * 1e-30f);
+            fprintf(out, "vt %f %f\r\n", unit(rng), unit(rng));
+            fprintf(out, "  vn %.6f %.6f %.6f\n", unit(rng), unit(rng), unit(rng));
+            positions++;
+            texcoords++;
+            normals++;
+        }
+
+        if(rng() % 10 == 0)
+            fprintf(out, "usemtl %s\n", (rng() % 2) ? "a" : "b");
+        if(rng() % 20 == 0)
+            fprintf(out, "\n\n   \n");
+
+        // same form for the faces of a block : with or without texcoords and normals
+        int form = rng() % 5;
+        for(int i = 0; i < 30; i++) {
+            int corners = 3 + rng() % 3;
+            fprintf(out, "f");
+            for(int k = 0; k < corners; k++) {
+                bool negative = (rng() % 5 == 0);
+                int p = negative ? -int(1 + rng() % 40) : int(1 + rng() % positions);
+                int t = negative ? -int(1 + rng() % 40) : int(1 + rng() % texcoords);
+                int n = negative ? -int(1 + rng() % 40) : int(1 + rng() % normals);
+                switch(form) {
+                    case 0: fprintf(out, " %d/%d/%d", p, t, n); break;
+                    case 1: fprintf(out, " %d/%d", p, t); break;
+                    case 2: fprintf(out, " %d//%d", p, n); break;
+                    case 3: fprintf(out, " %d", p); break;
+                    default: fprintf(out, "  %d/%d/%d ", p, t, n); break;
+                }
+            }
+            fprintf(out, "\n");
+        }
+    }
+
+    fclose(out);
+    return true;
+}
+
+template <typename T>
+static bool same(const char* name, const std::vector<T>& a, const std::vector<T>& b) {
+    if(a.size() != b.size()) {
+        printf("[error] %s : %zu / %zu\n", name, a.size(), b.size());
+        return false;
+    }
+    for(size_t i = 0; i < a.size(); ++i)
+        if(memcmp(&a[i], &b[i], sizeof(T)) != 0) {
+            printf("[error] %s : first difference %zu\n", name, i);
+            return false;
+        }
+    return true;
+}
+
+static bool compare(const char* name, const Mesh& reference, const Mesh& mesh) {
+    printf("%s : %d triangles\n", name, mesh.triangle_count());
+    bool ok = same("positions", reference.positions(), mesh.positions());
+    ok = same("texcoords", reference.texcoords(), mesh.texcoords()) && ok;
+    ok = same("normals", reference.normals(), mesh.normals()) && ok;
+    ok = same("materials", reference.materials(), mesh.materials()) && ok;
+    if(reference.mesh_material_count() != mesh.mesh_material_count()) {
+        printf("[error] mesh materials : %d / %d\n", reference.mesh_material_count(), mesh.mesh_material_count());
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    const char* filename = (argc > 1) ? argv[1] : "wavefront_test.obj";
+    std::string cache = std::string(filename) + ".gkmesh";
+    remove(cache.c_str());
+
+    if(!writeObj(filename)) {
+        printf("[error] writing '%s'...\n", filename);
+        return 1;
+    }
+
+    Mesh reference = readMeshReference(filename);
+    Mesh mesh = read_mesh(filename);
+    bool ok = compare("parser", reference, mesh);
+
+    // second read, from the binary cache
+    Mesh cached = read_mesh(filename);
+    ok = compare("cache", reference, cached) && ok;
+
+    remove(cache.c_str());
+    remove(filename);
+
+    printf("%s\n", ok ? "ok" : "[error] read_mesh differs from the reference parser");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+#version 330
+
+#ifdef VERTEX_SHADER
+// fullscreen triangle, no vertex buffer
+void main( )
+{
+    vec2 corners[3]= vec2[3]( vec2(-1, 3), vec2(-1, -1), vec2(3, -1) );
+    gl_Position= vec4(corners[gl_VertexID], 0, 1);
+}
+#endif
+
+#ifdef FRAGMENT_SHADER
+// offscreen image rendered at a lower resolution, in the bottom left corner of the texture, cf src/DynamicResolution.cpp
+uniform sampler2D color;
+uniform vec2 viewport;      // window size
+uniform vec2 extent;        // rendered size, in texture coordinates
+
+out vec4 fragment_color;
+
+void main( )
+{
+    vec2 texel= 1.0 / vec2(textureSize(color, 0));
+    // bilinear upscale, without reading outside the rendered rectangle
+    vec2 uv= min(gl_FragCoord.xy / viewport * extent, extent - 0.5 * texel);
+    // premultiplied alpha : blended over the camera image
+    fragment_color= texture(color, uv);
+}
+#endif
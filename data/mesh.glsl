@@ -3,11 +3,24 @@
 #ifdef VERTEX_SHADER
 
 layout(location= 0) in vec3 position;
-uniform mat4 mvpMatrix;
 
-uniform mat4 mvMatrix;
+// partage par tous les shaders, mis a jour une fois par image, cf camera_uniforms( )
+layout(std140, row_major) uniform camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewprojMatrix;
+};
+
+uniform mat4 modelMatrix;
 out vec3 vertex_position;
 
+#ifdef USE_QUANTIZED_POSITION
+    // positions 16 bits dans la boite englobante de l'objet, cf lib/vertex_format.h
+    uniform vec3 position_scale;
+    uniform vec3 position_offset;
+#endif
+
 #ifdef USE_TEXCOORD
     layout(location= 1) in vec2 texcoord;
     out vec2 vertex_texcoord;
@@ -27,9 +40,14 @@ out vec3 vertex_position;
 
 void main( )
 {
-    gl_Position= mvpMatrix * vec4(position, 1);
+#ifdef USE_QUANTIZED_POSITION
+    vec4 p= viewMatrix * (modelMatrix * vec4(position_offset + position_scale * position, 1));
+#else
+    vec4 p= viewMatrix * (modelMatrix * vec4(position, 1));
+#endif
+    gl_Position= projectionMatrix * p;
 
-    vertex_position= vec3(mvMatrix * vec4(position, 1));
+    vertex_position= vec3(p);
 
 #ifdef USE_TEXCOORD
     vertex_texcoord= texcoord;
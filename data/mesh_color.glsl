@@ -4,11 +4,10 @@
 #ifdef VERTEX_SHADER
 layout(location= 0) in vec3 position;
 
-uniform mat4 mvpMatrix;
-
+// fullscreen triangle, no matrix
 void main( )
 {
-    gl_Position = mvpMatrix * ivec4(0,0,0,1);
+    gl_Position = vec4(3,-1,-1,1);
     if(gl_VertexID == 0){
         gl_Position = vec4(-1,3,-1,1);
     }
@@ -28,12 +27,44 @@ in vec4 vertex_color;
 #endif
 
 uniform sampler2D diffuse_color;
+uniform sampler2D chroma_color;
+uniform int yuv_format;     // 0 : rgb, 1 : YUYV (y, u/v), 2 : NV12 (diffuse_color y, chroma_color uv)
 
 out vec4 fragment_color;
 
+// bt.601, video range
+vec4 yuv2rgb( float y, float u, float v )
+{
+    y= 1.164 * (y - 16.0 / 255.0);
+    u= u - 0.5;
+    v= v - 0.5;
+    return vec4(clamp(vec3(y + 1.596 * v, y - 0.392 * u - 0.813 * v, y + 2.017 * u), 0.0, 1.0), 1);
+}
+
 void main( )
 {
-    vec4 baseColor = texelFetch(diffuse_color, ivec2(gl_FragCoord.xy), 0);
-    fragment_color = baseColor;
+    ivec2 pixel= ivec2(gl_FragCoord.xy);
+    if(yuv_format == 0)
+    {
+        vec4 baseColor = texelFetch(diffuse_color, pixel, 0);
+        fragment_color = baseColor;
+        return;
+    }
+
+    // camera rows are top down, the flip is done here instead of on the cpu
+    pixel.y= textureSize(diffuse_color, 0).y - 1 - pixel.y;
+    float y= texelFetch(diffuse_color, pixel, 0).r;
+    if(yuv_format == 1)
+    {
+        // 2 pixels share u and v : y0 u y1 v
+        float u= texelFetch(diffuse_color, ivec2(pixel.x & ~1, pixel.y), 0).g;
+        float v= texelFetch(diffuse_color, ivec2(pixel.x | 1, pixel.y), 0).g;
+        fragment_color= yuv2rgb(y, u, v);
+    }
+    else
+    {
+        vec2 uv= texelFetch(chroma_color, pixel / 2, 0).rg;
+        fragment_color= yuv2rgb(y, uv.x, uv.y);
+    }
 }
 #endif
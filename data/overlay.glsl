@@ -0,0 +1,38 @@
+#version 330
+
+#ifdef VERTEX_SHADER
+// one instance per marker, cf src/Overlay.cpp
+layout(location= 0) in vec2 center;     // pixels, origin at the bottom left of the window
+layout(location= 1) in float size;      // half size, pixels
+layout(location= 2) in vec4 color;
+
+uniform vec2 viewport;
+
+out vec4 vertex_color;
+
+// square outline drawn as GL_LINES : 4 segments, 8 vertices
+const vec2 corners[8]= vec2[8](
+    vec2(-1, -1), vec2( 1, -1),
+    vec2( 1, -1), vec2( 1,  1),
+    vec2( 1,  1), vec2(-1,  1),
+    vec2(-1,  1), vec2(-1, -1) );
+
+void main( )
+{
+    // + 0.5 : lines on the pixel centers, like cv::rectangle
+    vec2 p= center + corners[gl_VertexID] * size + 0.5;
+    gl_Position= vec4(p / viewport * 2 - 1, 0, 1);
+    vertex_color= color;
+}
+#endif
+
+#ifdef FRAGMENT_SHADER
+in vec4 vertex_color;
+
+out vec4 fragment_color;
+
+void main( )
+{
+    fragment_color= vertex_color;
+}
+#endif
@@ -3,11 +3,20 @@
 #ifdef VERTEX_SHADER
 
 layout(location= 0) in vec3 position;
-uniform mat4 mvpMatrix;
+
+// partage par tous les shaders, cf camera_uniforms( )
+layout(std140, row_major) uniform camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewprojMatrix;
+};
+
+uniform mat4 modelMatrix;
 
 void main( )
 {
-    gl_Position= mvpMatrix * vec4(position, 1);
+    gl_Position= projectionMatrix * (viewMatrix * (modelMatrix * vec4(position, 1)));
 }
 #endif
 
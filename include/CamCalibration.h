@@ -9,22 +9,52 @@
 #include <sstream>
 #include <time.h>
 #include <stdio.h>
+#include <atomic>
+#include <functional>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/calib3d/calib3d.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv_modules.hpp>
+#ifdef HAVE_OPENCV_ARUCO
+#include <opencv2/aruco.hpp>
+#endif
 #include <mat.h>
 #include "vec.h"
 #include <glcore.h>
 #include <color.h>
+#include "FrameSource.h"
+#include "FrameContext.h"
+#include "TrackingStats.h"
 
 static const float SQUARESIZE = 31.6;
 static const int STREAMCAMERA = 0; // 0 : default camera, 1 or 2 : other camera
 
+// marker board : MARKERBOARD_X x MARKERBOARD_Y aruco markers (DICT_4X4_50), ids row by row from the top left marker
+static const int MARKERBOARD_X = 5;
+static const int MARKERBOARD_Y = 3;
+static const float MARKERSIZE = 31.6;
+static const float MARKERSEPARATION = 15.8;
+
+static const double LATENCY_THRESHOLD = 128; // luma of a lit led, cf setLatencyProbe()
+
 class CamCalibration {
 public:
+    enum TrackingMode { CHESSBOARD, MARKER_BOARD };
+
+    CamCalibration() : cam(nullptr), yuv(false), preview(true), flag(false), mode(CHESSBOARD), latencyProbe(false), probeLit(false), probeFrame(0), wandVisible(false), stopping(false), markerRoi() {}
+
     void start(std::string filePath = "out_camera_data.xml"); // Call load
+    void setTrackingMode(TrackingMode m){mode = m;}
+    void setCapture(std::string spec){captureSpec = spec;} // cf openFrameSource()
+    void setYUV(bool native){yuv = native;} // getMat() may then be YUYV (CV_8UC2) or NV12 (CV_8UC1), not flipped
+    void setLatencyProbe(bool probe){latencyProbe = probe;} // watch a led at the center of the frame, cf getProbe()
+    void setPreview(bool show){preview = show;} // highgui window with the detection, needs a display
+    void stop(){stopping = true;} // start() returns after the current frame
+    void setPublished(std::function<void()> callback){published = callback;} // called by the camera thread after each frame, before start()
+    TrackingMode getTrackingMode()const{return mode;}
+    static bool writeMarkerBoard(std::string filePath, int pixelsPerMarker = 200); // Image to print for MARKER_BOARD
 
     cv::Vec3d getRot()const{return euler;}
     cv::Mat gettVec()const{return transform;}
@@ -32,9 +62,14 @@ public:
     Transform getTransform()const{return transformation;};
     Transform getView()const{return view;};
     Point getMagicWand()const{return Point(magicWand.x, magicWand.y, 0.0);};
+    bool hasMagicWand()const{return wandVisible;}
 
     cv::Mat& getMat() {return image;}
     bool getFlag()const {return flag;}
+    PoseInfo getPoseInfo()const {return stats.last();}     // quality and timings of the last frame
+    const TrackingStats& getStats()const {return stats;}
+    bool getProbe()const {return probeLit;}                 // led lit in the frame getProbeFrame()
+    unsigned long getProbeFrame()const {return probeFrame;}
 
 private :
 
@@ -48,11 +83,31 @@ private :
     cv::Mat tvec;
     cv::Vec3d euler;
     cv::Mat transform;
-    cv::VideoCapture cam;
+    FrameSource* cam;
+    std::string captureSpec;
+    bool yuv;
+    bool preview;
     cv::Mat image;
     bool flag;
+    TrackingMode mode;
+    TrackingStats stats;
+    bool latencyProbe;
+    std::atomic<bool> probeLit;
+    std::atomic<unsigned long> probeFrame;
 
     cv::Point magicWand;
+    std::atomic<bool> wandVisible;          // found in the last frame
+    std::atomic<bool> stopping;
+    std::function<void()> published;
+
+    // marker board tracking
+#ifdef HAVE_OPENCV_ARUCO
+    cv::Ptr<cv::aruco::Dictionary> markerDictionary;
+    cv::Ptr<cv::aruco::DetectorParameters> markerParameters;
+#endif
+    cv::Rect markerRoi;                     // search window predicted from the last pose, empty : full frame
+    std::vector<std::vector<cv::Point2f> > markerCorners;
+    std::vector<int> markerIds;
 
     Transform lookat(const cv::Vec3f eye, const cv::Vec3f center, const cv::Vec3f up);
     std::vector<cv::Point3f> initPoint3D(int x, int y, float squareSize);
@@ -61,7 +116,11 @@ private :
     void getEulerAngle(cv::Mat &rotCamerMatrix,cv::Vec3d &eulerAngles);
     void computeFrustum();
     void computeTransform(cv::Mat rodri, cv::Mat translation);
-    bool findMagicWand(cv::Mat& view);
+    bool findMagicWand(FrameContext& frame);
+    bool findMarkerBoard(FrameContext& frame, std::vector<cv::Point2f>& pointImage, std::vector<cv::Point3f>& pointBoard);
+    cv::Point3f markerCorner(int id, int corner)const;
+    void predictMarkerRoi(const cv::Size& size);
+    void reprojection(const std::vector<cv::Point3f>& object, const std::vector<cv::Point2f>& pointImage, PoseInfo& info);
 
 };
 
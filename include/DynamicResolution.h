@@ -0,0 +1,45 @@
+#ifndef AR_DYNAMICRESOLUTION_H
+#define AR_DYNAMICRESOLUTION_H
+
+#include <glcore.h>
+#include <text.h>
+
+// Terrain and overlays rendered offscreen at a fraction of the window resolution, then upscaled over the camera image.
+// The scale follows the measured gpu time of the frames to hold the frame budget.
+class DynamicResolution {
+public:
+    DynamicResolution() : framebuffer(0), color(0), depth(0), program(0), vao(0),
+                          width(0), height(0), scale(1.f), budget(0.f), frames(0) {}
+
+    void init(int width, int height, float budget);     // window size, gpu time per frame in ms ; needs the gl context
+    void release();
+
+    // average gpu time of the last frames, in ms, cf Profiler::frame_gpu()
+    void update(float gpuTime);
+
+    // draws in the offscreen image, cleared transparent, until end()
+    void begin();
+    // back to the window, blends the upscaled image over it
+    void end();
+
+    float getScale()const{return scale;}
+    void print(Text& console, int x, int y)const;   // 1 line
+
+private:
+    int scaledWidth()const;
+    int scaledHeight()const;
+
+    GLuint framebuffer;
+    GLuint color;
+    GLuint depth;
+    GLuint program;
+    GLuint vao;
+    int width;
+    int height;
+    float scale;
+    float budget;
+    int frames;     // since the last change of scale
+};
+
+
+#endif //AR_DYNAMICRESOLUTION_H
@@ -0,0 +1,38 @@
+#ifndef AR_FRAMECONTEXT_H
+#define AR_FRAMECONTEXT_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+// Conversions of one camera frame, computed on first use and shared by every vision stage.
+// The frame is BGR (CV_8UC3), YUYV (CV_8UC2) or NV12 (CV_8UC1, height * 3/2), cf FrameSource
+class FrameContext {
+public:
+    FrameContext() : hasGray(false), hasHsv(false), levelCount(0) {}
+
+    // new frame : forgets the conversions of the previous one but keeps their buffers
+    void reset(const cv::Mat& image);
+
+    const cv::Mat& frame()const {return image;}
+    cv::Size size()const;
+    bool isYUV()const {return image.type() != CV_8UC3;}
+
+    const cv::Mat& gray();          // luma, a view of the frame for NV12
+    const cv::Mat& level(int i);    // gray pyramid, level 0 is gray(), level i is 2^i times smaller
+    const cv::Mat& hsv();           // BGR frames only
+    cv::Mat chroma()const;          // YUV frames only : YUYV as y0 u y1 v pairs (CV_8UC4), NV12 uv plane (CV_8UC2)
+
+private:
+    cv::Mat image;
+    cv::Mat grayImage;
+    std::vector<cv::Mat> levels;
+    cv::Mat hsvImage;
+
+    bool hasGray;
+    bool hasHsv;
+    int levelCount;     // valid levels
+};
+
+
+#endif //AR_FRAMECONTEXT_H
@@ -0,0 +1,136 @@
+#ifndef AR_FRAMESOURCE_H
+#define AR_FRAMESOURCE_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+static const int CAPTURE_WIDTH = 640;
+static const int CAPTURE_HEIGHT = 480;
+static const int CAPTURE_FPS = 60;
+static const int CAPTURE_BUFFERS = 4;     // small ring : a frame is never older than a few buffers
+static const int DECODE_THREADS = 2;
+
+typedef std::chrono::steady_clock::time_point CaptureTime;
+
+// Result of a grab : a new frame, no frame this time (late or undecodable, try again), or no frame ever again
+enum GrabResult { GRAB_FRAME, GRAB_DROPPED, GRAB_END };
+
+// Source of camera frames, grab() blocks until a new BGR frame is available
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    virtual bool open() = 0;
+    virtual GrabResult grab(cv::Mat& frame) = 0; // frame belongs to the caller until recycle()
+    virtual void release() = 0;
+    // gives a grabbed frame back once nothing uses it anymore, its buffer may be reused by the next frames
+    virtual void recycle(cv::Mat& frame) {frame.release();}
+
+    // before open() : deliver native YUYV (CV_8UC2) or NV12 (CV_8UC1, height * 3/2) frames when the camera has them, BGR otherwise
+    virtual void keepYUV(bool keep) {}
+
+    // when the last grabbed frame was captured : driver timestamp when available, steady_clock
+    CaptureTime captureTime()const {return stamp;}
+
+protected:
+    CaptureTime stamp;
+};
+
+// Decodes raw frames (MJPEG or YUYV) on worker threads and keeps only the newest one
+class DecodePool {
+public:
+    enum Format { MJPEG, YUYV, YUYV_RAW, NV12_RAW }; // *_RAW : copied as is, no color conversion
+
+    DecodePool(int workers = DECODE_THREADS);
+    ~DecodePool();
+
+    // data must stay valid until done() is called by the worker. false : every worker is busy, the frame is dropped
+    bool submit(Format format, const uchar* data, size_t size, int width, int height, size_t step, CaptureTime stamp, std::function<void()> done);
+    // waits for a frame newer than the last one returned
+    // GRAB_DROPPED : the newest submitted frame could not be decoded, or timeout milliseconds elapsed (-1 : no timeout), GRAB_END once stopped
+    GrabResult latest(cv::Mat& frame, CaptureTime& stamp, int timeout = -1);
+    // frame comes back from the consumer, no other reference on its buffer may remain
+    void recycle(cv::Mat& frame);
+    void stop();
+
+private:
+    struct Job {
+        Format format;
+        const uchar* data;
+        size_t size;
+        int width;
+        int height;
+        size_t step;
+        CaptureTime stamp;
+        std::function<void()> done;
+        unsigned long id;
+    };
+
+    void work();
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable frameReady;
+    std::deque<Job> jobs;
+    int idle;
+    unsigned long submitted;
+    unsigned long published;
+    unsigned long failed;       // last frame that could not be decoded
+    unsigned long delivered;
+    cv::Mat newest;
+    CaptureTime newestStamp;
+    std::vector<cv::Mat> freeBuffers;   // owned by the pool, reused by the workers
+    bool stopped;
+};
+
+// cv::VideoCapture : camera index or video file
+class CvSource : public FrameSource {
+public:
+    CvSource(int camera) : camera(camera) {}
+    CvSource(std::string file) : camera(-1), file(file) {}
+
+    bool open() override;
+    GrabResult grab(cv::Mat& frame) override;
+    void release() override;
+
+private:
+    int camera;
+    std::string file;
+    cv::VideoCapture capture;
+};
+
+// Stand-in for the camera : replays a file of concatenated jpeg images (.mjpg) through the decode workers
+class MjpegFileSource : public FrameSource {
+public:
+    MjpegFileSource(std::string file, int fps = CAPTURE_FPS) : file(file), fps(fps), next(0) {}
+
+    bool open() override;
+    GrabResult grab(cv::Mat& frame) override;
+    void release() override;
+    void recycle(cv::Mat& frame) override {pool.recycle(frame);}
+
+private:
+    std::string file;
+    int fps;
+    std::vector<uchar> data;
+    std::vector<std::pair<size_t, size_t> > frames; // offset, size
+    size_t next;
+    std::chrono::steady_clock::time_point deadline;
+    DecodePool pool;
+};
+
+// spec : "" default camera, "/dev/videoN" v4l2 device, "N" opencv camera, "*.mjpg" replay, anything else a video file
+FrameSource* openFrameSource(const std::string& spec, bool yuv = false);
+
+
+#endif //AR_FRAMESOURCE_H
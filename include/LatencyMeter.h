@@ -0,0 +1,56 @@
+#ifndef AR_LATENCYMETER_H
+#define AR_LATENCYMETER_H
+
+#include <deque>
+#include <ostream>
+#include <vector>
+
+#include <glcore.h>
+#include <text.h>
+
+#include "FrameSource.h"
+#include "TrackingStats.h"
+
+// Motion to photon latency : camera capture -> render -> gpu done -> swap,
+// gpu times from GL_TIMESTAMP queries, read back without stalling once the fence after the swap is signaled
+class LatencyMeter {
+public:
+    LatencyMeter();
+
+    void init();        // needs the gl context
+    void release();
+
+    // end of render(), just before the swap : frame and capture time of the camera image that was drawn, when render() started
+    void rendered(unsigned long frame, CaptureTime captured, CaptureTime started);
+    // just after the swap
+    void presented();
+
+    void dump(std::ostream& out)const;
+    void print(Text& console, int x, int y)const;   // 6 lines
+
+private:
+    struct Pending {
+        CaptureTime captured;
+        CaptureTime started;
+        CaptureTime swapped;
+        GLuint query;
+        GLsync fence;
+    };
+
+    void synchronize();     // gpu clock -> steady_clock offset
+    void collect();
+
+    std::deque<Pending> pending;
+    std::vector<GLuint> queries;    // free
+    unsigned long lastFrame;
+    long long offset;               // steady_clock - gpu clock, nanoseconds
+    int frames;
+
+    Histogram render;       // capture -> render
+    Histogram gpu;          // capture -> gpu done
+    Histogram swap;         // capture -> swap returned
+    Histogram fence;        // capture -> fence seen signaled (upper bound)
+};
+
+
+#endif //AR_LATENCYMETER_H
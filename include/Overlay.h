@@ -0,0 +1,40 @@
+#ifndef AR_OVERLAY_H
+#define AR_OVERLAY_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glcore.h>
+#include <color.h>
+#include <vec.h>
+
+// Square markers over the camera image (grid nodes, wand), drawn by the gpu in one instanced draw
+class Overlay {
+public:
+    Overlay() : program(0), vao(0), buffer(0), capacity(0) {}
+
+    void init();        // needs the gl context
+    void release();
+
+    void clear();
+    // center in window pixels (origin at the bottom left, like the flipped camera image), halfSize in pixels
+    void marker(const Point& center, float halfSize, const Color& color);
+
+    void draw(int width, int height);
+
+private:
+    struct Instance {
+        float x, y;
+        float size;
+        unsigned char color[4];
+    };
+
+    std::vector<Instance> instances;
+    GLuint program;
+    GLuint vao;
+    GLuint buffer;
+    size_t capacity;    // instances in the buffer
+};
+
+
+#endif //AR_OVERLAY_H
@@ -0,0 +1,66 @@
+#ifndef AR_RECORDER_H
+#define AR_RECORDER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <glcore.h>
+#include <text.h>
+
+static const int RECORD_BUFFERS = 3;    // pixel pack buffers in flight, read back a few frames later
+static const int RECORD_QUEUE = 8;      // frames waiting for the encoder, the next ones are dropped
+
+// Session recording : the window is read back through a ring of pixel pack buffers with fences,
+// the frames are encoded by a thread, the render loop never waits for the gpu or the encoder
+class Recorder {
+public:
+    Recorder();
+    ~Recorder();
+
+    // file : video (.avi mjpeg, .mp4), or an image sequence with a printf pattern, frame%05d.png ; needs the gl context
+    bool start(const std::string& file, int width, int height, double fps);
+    // end of render(), before the swap : reads back the window
+    void frame();
+    // waits for the last frames and the encoder
+    void stop();
+
+    bool recording()const {return !slots.empty();}
+    void print(Text& console, int x, int y);     // 1 line
+
+private:
+    struct Slot {
+        GLuint buffer;
+        GLsync fence;
+    };
+
+    void collect(bool wait);
+    void encode();
+
+    std::vector<Slot> slots;
+    int head;           // oldest read back in flight
+    int count;          // read backs in flight
+    int width;
+    int height;
+
+    std::string pattern;
+    cv::VideoWriter writer;
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<cv::Mat> queue;   // BGRA, bottom up
+    bool stopping;
+
+    unsigned long recorded;
+    unsigned long dropped;
+    unsigned long encoded;
+};
+
+
+#endif //AR_RECORDER_H
@@ -16,6 +16,7 @@ public:
     Shader(){};
     Shader(char* filename, int);
     void draw(const Transform& view, const Transform& proj, GLuint texture);
+    void draw(const Transform& view, const Transform& proj, GLuint texture, GLuint chroma, int yuvFormat); // cf data/mesh_color.glsl
     void setVertexArray(GLuint _vao);
     void setVertexArray(const std::vector<Vector>& vec);
     void setVertexArray(const float* vec, int nb);
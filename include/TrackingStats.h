@@ -0,0 +1,85 @@
+#ifndef AR_TRACKINGSTATS_H
+#define AR_TRACKINGSTATS_H
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <text.h>
+
+static const float INLIER_ERROR = 2.f;     // reprojection error (pixels) of an inlier
+static const int STATS_WINDOW = 300;        // rolling window, frames
+
+// What the tracker knows about one published pose
+struct PoseInfo {
+    unsigned long frame = 0;
+    bool tracked = false;
+    float rms = 0.f;            // reprojection error of the pose, pixels
+    int inliers = 0;            // points reprojected closer than INLIER_ERROR
+    int points = 0;             // detected points used by solvePnP
+    std::chrono::steady_clock::time_point captured;
+
+    // stage timings, milliseconds
+    float grab = 0.f;           // waiting for the camera
+    float detect = 0.f;         // frame conversion, chessboard / marker detection, subpixel refinement
+    float pose = 0.f;           // solvePnP and reprojection
+    float wand = 0.f;
+    float total = 0.f;          // capture to the end of the frame
+
+    float confidence()const {return points > 0 ? (float) inliers / points : 0.f;}
+};
+
+// Histogram of the last `window` values, clamped in [0, max]
+class Histogram {
+public:
+    Histogram(float max = 1.f, int bins = 20, int window = STATS_WINDOW);
+
+    void add(float value);
+    int count()const {return filled;}
+    float mean()const {return filled > 0 ? (float) (sum / filled) : 0.f;}
+    float maximum()const;
+    float percentile(float p)const;         // upper bound of the bin, p in [0, 1]
+    std::string summary(const char* name)const;    // name, mean, p50, p95, max and the shape of the histogram
+
+    const std::vector<int>& bins()const {return counts;}
+    float range()const {return max;}
+
+private:
+    float max;
+    std::vector<int> counts;
+    std::vector<float> values;              // ring of the window
+    int next;
+    int filled;
+    double sum;
+
+    int bin(float value)const;
+};
+
+// Rolling statistics of the tracker, written by the camera thread, read by the renderer
+class TrackingStats {
+public:
+    TrackingStats(int window = STATS_WINDOW);
+
+    void add(const PoseInfo& info);
+    PoseInfo last()const;
+
+    void dump(std::ostream& out)const;
+    void print(Text& console, int x, int y)const;   // 9 lines
+
+private:
+    mutable std::mutex mutex;
+    PoseInfo latest;
+    unsigned long frames;
+    Histogram tracked;      // 0 lost, 1 tracked
+    Histogram rms;
+    Histogram grab;
+    Histogram detect;
+    Histogram pose;
+    Histogram wand;
+    Histogram total;
+};
+
+
+#endif //AR_TRACKINGSTATS_H
@@ -0,0 +1,50 @@
+#ifndef AR_V4L2SOURCE_H
+#define AR_V4L2SOURCE_H
+
+#include <atomic>
+
+#include "FrameSource.h"
+
+// Native V4L2 capture : mmap buffers, MJPEG (or YUYV) negotiated at CAPTURE_FPS, decoded by a DecodePool
+// with keepYUV() : YUYV or NV12 negotiated first and delivered without color conversion
+class V4L2Source : public FrameSource {
+public:
+    V4L2Source(std::string device, int width = CAPTURE_WIDTH, int height = CAPTURE_HEIGHT, int fps = CAPTURE_FPS, int bufferCount = CAPTURE_BUFFERS);
+    ~V4L2Source() { release(); }
+
+    bool open() override;
+    GrabResult grab(cv::Mat& frame) override;
+    void release() override;
+    void recycle(cv::Mat& frame) override {pool.recycle(frame);}
+    void keepYUV(bool keep) override {yuv = keep;}
+
+private:
+    struct Buffer {
+        void* start;
+        size_t length;
+    };
+
+    bool negotiate();
+    bool mapBuffers();
+    void capture(); // capture thread : dequeue filled buffers and hand them to the decoders
+    void requeue(unsigned int index);
+
+    std::string device;
+    int width;
+    int height;
+    int fps;
+    int bufferCount;
+    bool yuv;
+
+    int fd;
+    unsigned int pixelFormat;
+    size_t bytesPerLine;
+    std::vector<Buffer> buffers;
+
+    DecodePool pool;
+    std::thread thread;
+    std::atomic<bool> running;
+};
+
+
+#endif //AR_V4L2SOURCE_H
@@ -1,46 +1,123 @@
 
 //! \file app.cpp
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <thread>
 
 #include "app.h"
+#include "headless.h"
+#include "program.h"
+#include "state.h"
 #include "glcore.h"
 
 
-App::App( const int width, const int height, const int major, const int minor )
-    : m_window(nullptr), m_context(nullptr)
+App::App( const int width, const int height, const int major, const int minor, const bool headless )
+    : m_window(nullptr), m_context(nullptr), m_headless(headless),
+    m_pacing(PACING_VSYNC), m_period(1000.f / 60.f), m_work(0.f)
 {
-    m_window= create_window(width, height);
-    m_context= create_context(m_window, major, minor);
+    if(m_headless)
+    {
+        if(create_headless_window(width, height) == 0)
+            m_context= create_headless_context(width, height, major, minor);
+    }
+    else
+    {
+        m_window= create_window(width, height);
+        m_context= create_context(m_window, major, minor);
+    }
 }
 
 App::~App( )
 {
     if(m_context)
-        release_context(m_context);
+    {
+        if(m_headless)
+            release_headless_context(m_context);
+        else
+            release_context(m_context);
+    }
     if(m_window)
         release_window(m_window);
 }
 
+void App::pacing( const Pacing mode )
+{
+    m_pacing= mode;
+    if(m_headless)
+        return;
+    
+    SDL_GL_SetSwapInterval(mode == PACING_UNCAPPED ? 0 : 1);
+    
+    SDL_DisplayMode display;
+    if(SDL_GetWindowDisplayMode(m_window, &display) == 0 && display.refresh_rate > 0)
+        m_period= 1000.f / display.refresh_rate;
+}
+
+int App::next_frame( )
+{
+    if(m_pacing == PACING_ON_DEMAND)
+        return wait_events(m_window, 1000);
+    
+    if(m_pacing == PACING_LOW_LATENCY)
+    {
+        // commence l'image juste assez tot pour la terminer avant le prochain rafraichissement, avec une marge de 2ms
+        float wait= m_period - m_work - 2.f;
+        if(wait > 0)
+            std::this_thread::sleep_until(m_vsync + std::chrono::microseconds(int(wait * 1000.f)));
+    }
+    
+    m_start= clock::now();
+    return events(m_window);
+}
+
+void App::swap( )
+{
+    if(m_pacing == PACING_LOW_LATENCY)
+    {
+        // duree de l'image, cpu et gpu : s'adapte vite quand elle augmente, lentement quand elle diminue
+        glFinish();
+        float work= std::chrono::duration<float, std::milli>(clock::now() - m_start).count();
+        m_work= std::max(work, m_work * 0.95f + work * 0.05f);
+    }
+    
+    if(m_headless)
+        swap_headless(m_context);
+    else
+        SDL_GL_SwapWindow(m_window);
+    
+    if(m_pacing == PACING_LOW_LATENCY)
+    {
+        // attend le rafraichissement : pas d'image en attente dans le driver
+        glFinish();
+        m_vsync= clock::now();
+    }
+}
+
 int App::run( )
 {
-    if(init() < 0)
+    if(m_context == nullptr || init() < 0)
         return -1;
 
     // configure openGL
     glViewport(0, 0, window_width(), window_height());
 
     // gestion des evenements
-    while(events(m_window))
+    while(next_frame())
     {
         if(update(global_time(), delta_time()) < 0)
             break;
+        
+        // recharge les shaders modifies
+        update_programs();
         if(render() < 1)
             break;
 
         // presenter le resultat
-        SDL_GL_SwapWindow(m_window);
+        swap();
+        presented();
+        state_frame();
     }
 
     if(quit() < 0)
@@ -2,6 +2,8 @@
 #ifndef _APP_H
 #define _APP_H
 
+#include <chrono>
+
 #include "window.h"
 
 
@@ -13,14 +15,25 @@
 
     la class App expose les fonctionnalites de window.h, elles sont juste presentees differemment.
     les fonctions globales de window.h sont toujours utilisables (a part run() qui est remplace par App::run()).
+
+    sans fenetre (headless = true), le rendu se fait dans une surface hors ecran, cf headless.h, key_state() renvoie toujours 0.
 */
 
+//! rythme des images, cf App::pacing().
+enum Pacing
+{
+    PACING_VSYNC= 0,        //!< une image par rafraichissement de l'ecran, par defaut.
+    PACING_LOW_LATENCY,     //!< synchronise avec l'ecran, commence l'image le plus tard possible avant le rafraichissement : les evenements et les donnees lues par render() sont plus recents.
+    PACING_ON_DEMAND,       //!< dessine une image uniquement apres un evenement, ou wake_events() depuis un autre thread, et au moins une fois par seconde.
+    PACING_UNCAPPED         //!< sans synchronisation avec l'ecran, pour les benchmarks.
+};
+
 //! classe application.
 class App
 {
 public:
-    //! constructeur, dimensions de la fenetre et version d'openGL.
-    App( const int width, const int height, const int major= 3, const int minor= 3 );
+    //! constructeur, dimensions de la fenetre et version d'openGL. headless : sans fenetre, cf headless.h.
+    App( const int width, const int height, const int major= 3, const int minor= 3, const bool headless= false );
     virtual ~App( );
 
     //! a deriver pour creer les objets openGL. renvoie -1 pour indiquer une erreur, 0 sinon.
@@ -32,13 +45,32 @@ public:
     virtual int update( const float time, const float delta ) { return 0; }
     //! a deriver pour afficher les objets. renvoie 1 pour continuer, 0 pour fermer l'application.
     virtual int render( ) = 0;
+    //! a deriver pour mesurer la latence, appelee juste apres la presentation de l'image par swap().
+    virtual void presented( ) {}
 
     //! execution de l'application.
     int run( );
     
+    //! choisit le rythme des images. necessite le contexte openGL.
+    void pacing( const Pacing mode );
+    
 protected:
+    //! attend la prochaine image, selon le rythme, et traite les evenements. renvoie 0 pour fermer l'application.
+    int next_frame( );
+
+    //! presente l'image : SDL_GL_SwapWindow() ou swap_headless().
+    void swap( );
+
     Window m_window;
     Context m_context;
+    bool m_headless;
+    
+    typedef std::chrono::high_resolution_clock clock;
+    Pacing m_pacing;
+    float m_period;                 //!< rafraichissement de l'ecran, en ms.
+    float m_work;                   //!< duree d'une image, cpu + gpu, en ms.
+    clock::time_point m_start;      //!< debut de l'image.
+    clock::time_point m_vsync;      //!< fin de la derniere presentation.
 };
 
 
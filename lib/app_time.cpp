@@ -1,62 +1,83 @@
 
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 
 #include "app_time.h"
+#include "program.h"
+#include "state.h"
 #include "texture.h"
 
 
-AppTime::AppTime( const int width, const int height, const int major, const int minor ) : App(width, height, major, minor) {}
+AppTime::AppTime( const int width, const int height, const int major, const int minor, const bool headless ) : App(width, height, major, minor, headless), m_show_console(false), m_console_dumped(0) {}
 AppTime::~AppTime( ) {}
 
+// changements d'etat openGL de l'image precedente, transmis / demandes
+static void state_summary( char *states )
+{
+    states[0]= 0;
+    for(int i= 0; i < STATE_CATEGORIES; i++)
+    {
+        const StateCounters& counters= state_counters(i);
+        sprintf(states + strlen(states), "%s %d/%d  ", state_category_name(i), counters.changes, counters.requests);
+    }
+}
+
 
 int AppTime::run( )
 {
-    if(m_window == nullptr || m_context == nullptr || init() < 0)
+    if(m_context == nullptr || init() < 0)
         return -1;
     
-    // requete pour mesurer le temps gpu
-//    lGenQueries(1, &m_time_query);
+    // requetes pour mesurer le temps gpu, relues quelques images plus tard
+    m_profiler.create();
     
-    // affichage du temps  dans la fenetre
-    m_console= create_text();
+    // affichage du temps dans la fenetre, si necessaire, cf show_console( )
+    if(m_show_console)
+        m_console= create_text();
     
     // configure openGL
     glViewport(0, 0, window_width(), window_height());
     
-    // remarque : utiliser std::chrono si la precision n'est pas suffisante
-    while(events(m_window))
+    while(next_frame())
     {
         if(update(global_time(), delta_time()) < 0)
             break;
         
-        // mesure le temps d'execution du draw pour le gpu
-        glBeginQuery(GL_TIME_ELAPSED, m_time_query);
+        // recharge les shaders modifies
+        update_programs();
         
-        // mesure le temps d'execution du draw pour le cpu
-        // utilise std::chrono pour mesurer le temps cpu 
-        std::chrono::high_resolution_clock::time_point cpu_start= std::chrono::high_resolution_clock::now();
+        // mesure le temps d'execution du draw pour le cpu et le gpu, sans attendre le gpu
+        m_profiler.frame_begin();
+        clear(m_console);
         
         int code= render();
         
-        std::chrono::high_resolution_clock::time_point cpu_stop= std::chrono::high_resolution_clock::now();
-        // conversion des mesures en duree...
-        int cpu_time= std::chrono::duration_cast<std::chrono::nanoseconds>(cpu_stop - cpu_start).count();
-        
-        glEndQuery(GL_TIME_ELAPSED);
+        m_profiler.frame_end();
         
         if(code< 1)
             break;
         
-        // attendre le resultat de la requete
-        GLint64 gpu_time= 0;
-        glGetQueryObjecti64v(m_time_query, GL_QUERY_RESULT, &gpu_time);
-        
-        // afficher le texte
-        clear(m_console);        
-        printf(m_console, 0, 1, "cpu  %02dms %03dus", (int) (cpu_time / 1000000), (int) ((cpu_time / 1000) % 1000));
-        printf(m_console, 0, 2, "gpu  %02dms %03dus", (int) (gpu_time / 1000000), (int) ((gpu_time / 1000) % 1000));        
-        
-        draw(m_console, window_width(), window_height());
+        if(console_ready())
+        {
+            // afficher le texte, en bas de la console
+            print(m_console, m_profiler, 0, 23 - m_profiler.scopes());
+            
+            char states[128];
+            state_summary(states);
+            printf(m_console, 0, 22 - m_profiler.scopes(), "%s", states);
+            
+            draw(m_console, window_width(), window_height());
+        }
+        else if(m_show_console && global_time() - m_console_dumped > 5000)
+        {
+            // pas de console : memes informations dans le terminal, toutes les 5s
+            char states[128];
+            state_summary(states);
+            print(stdout, m_profiler);
+            printf("%s\n", states);
+            m_console_dumped= global_time();
+        }
         
         if(key_state('s'))
         {
@@ -65,13 +86,15 @@ int AppTime::run( )
         }
         
         // presenter le resultat
-        SDL_GL_SwapWindow(m_window);
+        swap();
+        presented();
+        state_frame();
     }
     
     if(quit() < 0)
         return -1;
     
-    glDeleteQueries(1, &m_time_query);
+    m_profiler.release();
     release_text(m_console);    
     
     return 0;    
@@ -5,17 +5,20 @@
 #include "glcore.h"
 #include "app.h"
 #include "text.h"
+#include "profiler.h"
 
 
 //! \addtogroup application utilitaires pour creer une application
 
 //! \file
-//! classe application, avec mesure integree du temps d'execution cpu et gpu.
+//! classe application, avec mesure integree du temps d'execution cpu et gpu, par etape avec m_profiler.
+//! render() peut afficher du texte dans m_console, effacee avant chaque image.
+//! si la console ne peut pas etre creee (police ou shader absents), les temps sont ecrits dans le terminal toutes les 5s.
 class AppTime : public App
 {
 public:
-    //! constructeur, dimensions de la fenetre et version d'openGL.
-    AppTime( const int width, const int height, const int major= 3, const int minor= 3 );
+    //! constructeur, dimensions de la fenetre et version d'openGL. headless : sans fenetre, cf headless.h.
+    AppTime( const int width, const int height, const int major= 3, const int minor= 3, const bool headless= false );
     virtual ~AppTime( );
 
     //! a deriver pour creer les objets openGL.
@@ -26,15 +29,22 @@ public:
     //! a deriver et redefinir pour animer les objets en fonction du temps.
     using App::update;
 
-    //! a deriver pour afficher les objets.
+    //! a deriver pour afficher les objets. les etapes mesurees sont delimitees par ProfilerScope(m_profiler, "nom").
     virtual int render( ) = 0;
 
     //! execution de l'application.
     int run( );
 
+    //! affiche la console, avec les temps du profiler. a appeler dans init( ), cf create_text( ).
+    void show_console( const bool show= true ) { m_show_console= show; }
+    //! renvoie true si la console est affichee.
+    bool console_ready( ) const { return text_ready(m_console); }
+
 protected:
+    bool m_show_console;
+    float m_console_dumped;     //!< dernier affichage dans le terminal, sans console, en ms.
     Text m_console;
-    GLuint m_time_query;
+    Profiler m_profiler;
 };
 
 
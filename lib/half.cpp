@@ -0,0 +1,68 @@
+//! \file half.cpp
+
+#include <cstring>
+
+#include "half.h"
+
+
+uint16_t float_to_half( const float f )
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    
+    uint32_t sign= (x >> 16) & 0x8000u;
+    uint32_t mantissa= x & 0x7fffffu;
+    int e= int((x >> 23) & 0xff);
+    if(e == 0xff)
+        // inf, nan
+        return uint16_t(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    
+    int exponent= e - 127 + 15;
+    if(exponent >= 31)
+        // trop grand : inf
+        return uint16_t(sign | 0x7c00u);
+    
+    if(exponent <= 0)
+    {
+        // trop petit : denormalise ou 0
+        if(exponent < -10)
+            return uint16_t(sign);
+        mantissa= (mantissa | 0x800000u) >> (1 - exponent);
+        if(mantissa & 0x1000u)
+            mantissa+= 0x2000u;
+        return uint16_t(sign | (mantissa >> 13));
+    }
+    
+    // arrondi, la retenue passe dans l'exposant si necessaire
+    uint32_t h= sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+    if(mantissa & 0x1000u)
+        h++;
+    return uint16_t(h);
+}
+
+float half_to_float( const uint16_t h )
+{
+    uint32_t sign= uint32_t(h & 0x8000u) << 16;
+    uint32_t exponent= (h >> 10) & 0x1fu;
+    uint32_t mantissa= h & 0x3ffu;
+    
+    uint32_t x;
+    if(exponent == 0x1f)
+        // inf, nan
+        x= sign | 0x7f800000u | (mantissa << 13);
+    else if(exponent != 0)
+        x= sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    else if(mantissa == 0)
+        x= sign;
+    else
+    {
+        // denormalise : normalise la mantisse
+        int e= -1;
+        do { e++; mantissa<<= 1; } while((mantissa & 0x400u) == 0);
+        x= sign | (uint32_t(127 - 15 - e) << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+    
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
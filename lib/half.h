@@ -0,0 +1,19 @@
+#ifndef _HALF_H
+#define _HALF_H
+
+#include <cstdint>
+
+
+//! \addtogroup math
+///@{
+
+//! \file
+//! conversions float <-> half float, 16 bits, cf GL_HALF_FLOAT.
+
+//! conversion float -> half float, arrondi au plus proche.
+uint16_t float_to_half( const float f );
+//! conversion half float -> float, exacte.
+float half_to_float( const uint16_t h );
+
+///@}
+#endif
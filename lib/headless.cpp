@@ -0,0 +1,148 @@
+
+//! \file headless.cpp
+
+#include <cstdio>
+#include <cstring>
+
+#include "glcore.h"
+#include "headless.h"
+
+#ifdef GK_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+struct HeadlessContext
+{
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+};
+
+static EGLDisplay headless_display( )
+{
+    // pas de serveur graphique : plateforme surfaceless de mesa, si elle est disponible
+    const char *extensions= eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display= (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(extensions && strstr(extensions, "EGL_MESA_platform_surfaceless") && get_platform_display)
+    {
+        EGLDisplay display= get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display != EGL_NO_DISPLAY)
+            return display;
+    }
+    
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+Context create_headless_context( const int width, const int height, const int major, const int minor )
+{
+    EGLDisplay display= headless_display();
+    EGLint egl_major= 0, egl_minor= 0;
+    if(display == EGL_NO_DISPLAY || eglInitialize(display, &egl_major, &egl_minor) == EGL_FALSE)
+    {
+        printf("[error] EGL initialization failed.\n");
+        return NULL;
+    }
+    printf("EGL %d.%d %s\n", egl_major, egl_minor, eglQueryString(display, EGL_VENDOR));
+    
+    const EGLint config_attributes[]= {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs= 0;
+    if(eglChooseConfig(display, config_attributes, &config, 1, &configs) == EGL_FALSE || configs == 0)
+    {
+        printf("[error] no EGL pbuffer configuration.\n");
+        eglTerminate(display);
+        return NULL;
+    }
+    
+    const EGLint surface_attributes[]= { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    EGLSurface surface= eglCreatePbufferSurface(display, config, surface_attributes);
+    if(surface == EGL_NO_SURFACE)
+    {
+        printf("[error] creating EGL pbuffer %dx%d.\n", width, height);
+        eglTerminate(display);
+        return NULL;
+    }
+    
+    // meme configuration que create_context( )
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint context_attributes[]= {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, major,
+        EGL_CONTEXT_MINOR_VERSION_KHR, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+#ifndef GK_RELEASE
+        EGL_CONTEXT_FLAGS_KHR, EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR,
+#endif
+        EGL_NONE
+    };
+    EGLContext context= eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+    if(context == EGL_NO_CONTEXT || eglMakeCurrent(display, surface, surface, context) == EGL_FALSE)
+    {
+        printf("[error] creating openGL %d.%d context.\n", major, minor);
+        if(context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglDestroySurface(display, surface);
+        eglTerminate(display);
+        return NULL;
+    }
+    
+    // charge les fonctions du contexte EGL, avec glew compile pour EGL ou pour GLX (cf libglvnd), sans serveur X
+    if(init_extensions(true) < 0)
+    {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglDestroySurface(display, surface);
+        eglTerminate(display);
+        return NULL;
+    }
+    
+    printf("headless %dx%d : %s\n", width, height, (const char *) glGetString(GL_RENDERER));
+    
+    HeadlessContext *headless= new HeadlessContext;
+    headless->display= display;
+    headless->surface= surface;
+    headless->context= context;
+    return headless;
+}
+
+void release_headless_context( Context context )
+{
+    HeadlessContext *headless= (HeadlessContext *) context;
+    if(headless == NULL)
+        return;
+    
+    eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(headless->display, headless->context);
+    eglDestroySurface(headless->display, headless->surface);
+    eglTerminate(headless->display);
+    delete headless;
+}
+
+void swap_headless( Context context )
+{
+    HeadlessContext *headless= (HeadlessContext *) context;
+    if(headless == NULL)
+        return;
+    
+    // pas d'affichage : soumet les commandes de l'image, sans attendre le gpu
+    eglSwapBuffers(headless->display, headless->surface);
+    glFlush();
+}
+
+#else
+
+Context create_headless_context( const int width, const int height, const int major, const int minor )
+{
+    printf("[error] headless context : gKit built without EGL (cmake -DHEADLESS=ON).\n");
+    return NULL;
+}
+
+void release_headless_context( Context context ) {}
+void swap_headless( Context context ) {}
+
+#endif
@@ -0,0 +1,30 @@
+
+#ifndef _HEADLESS_H
+#define _HEADLESS_H
+
+#include "window.h"
+
+
+//! \addtogroup application
+///@{
+
+//! \file
+/*! contexte openGL sans fenetre ni serveur graphique, pour les serveurs et les benchmarks : EGL et une surface pbuffer hors ecran.
+le framebuffer 0 est la surface pbuffer, le rendu de l'application ne change pas. cf App( width, height, major, minor, true ).
+
+necessite gKit compile avec EGL, cmake -DHEADLESS=ON (definit GK_HEADLESS).
+rendu logiciel avec mesa (llvmpipe) :
+\code
+EGL_PLATFORM=surfaceless LIBGL_ALWAYS_SOFTWARE=1 ./AR --headless
+\endcode
+*/
+
+//! cree un contexte openGL core profile et une surface hors ecran width x height, le contexte est courant. renvoie NULL en cas d'erreur.
+Context create_headless_context( const int width, const int height, const int major= 3, const int minor= 3 );
+//! detruit le contexte et la surface.
+void release_headless_context( Context context );
+//! termine une image, equivalent de SDL_GL_SwapWindow() pour la surface hors ecran.
+void swap_headless( Context context );
+
+///@}
+#endif
@@ -0,0 +1,252 @@
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GK_IMAGE_SIMD
+#include <immintrin.h>
+#endif
+
+#include "image_convert.h"
+
+
+// decoupe l'image en bandes de lignes, 1 par thread, pour les grandes images
+template < typename Function >
+static void parallel_rows( const int width, const int height, const Function& convert )
+{
+    unsigned int threads= std::max(1u, std::thread::hardware_concurrency());
+    // au moins 64k pixels par thread
+    threads= std::min(threads, (unsigned int) (size_t(width) * height / 65536) +1);
+    if(threads < 2)
+    {
+        convert(0, height);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    int band= (height + threads -1) / threads;
+    for(int y= band; y < height; y+= band)
+        workers.push_back( std::thread(convert, y, std::min(y + band, height)) );
+    convert(0, std::min(band, height));
+
+    for(unsigned int i= 0; i < (unsigned int) workers.size(); i++)
+        workers[i].join();
+}
+
+
+// 1 ligne, versions scalaires
+static void swizzle_row( const unsigned char *src, const int src_bpp, const int offsets[4], unsigned char *dst, const int dst_channels, const int begin, const int width )
+{
+    for(int x= begin; x < width; x++)
+    {
+        const unsigned char *pixel= src + x * src_bpp;
+        unsigned char *texel= dst + x * dst_channels;
+        for(int c= 0; c < dst_channels; c++)
+            texel[c]= (offsets[c] < 0) ? 255 : pixel[offsets[c]];
+    }
+}
+
+static void float_row( const unsigned char *src, float *dst, const int begin, const int n )
+{
+    for(int i= begin; i < n; i++)
+        dst[i]= (float) src[i] / 255.f;
+}
+
+static void byte_row( const float *src, unsigned char *dst, const int begin, const int n )
+{
+    for(int i= begin; i < n; i++)
+    {
+        float v= std::floor(src[i] * 255.f);
+        // nan et valeurs negatives : 0
+        dst[i]= (v > 0) ? (unsigned char) std::min(v, 255.f) : 0;
+    }
+}
+
+
+#ifdef GK_IMAGE_SIMD
+static bool cpu_ssse3( ) { static bool ssse3= __builtin_cpu_supports("ssse3"); return ssse3; }
+static bool cpu_avx2( ) { static bool avx2= __builtin_cpu_supports("avx2"); return avx2; }
+
+// pshufb : 4 ou 5 pixels par instruction. renvoie le nombre de pixels convertis.
+__attribute__((target("ssse3")))
+static int swizzle_row_ssse3( const unsigned char *src, const int src_bpp, const int offsets[4], unsigned char *dst, const int dst_channels, const int width )
+{
+    // pixels par iteration : 16 octets lus et ecrits
+    int step= std::min(16 / src_bpp, 16 / dst_channels);
+
+    alignas(16) char shuffle[16];
+    alignas(16) char alpha[16];
+    for(int i= 0; i < 16; i++)
+    {
+        int x= i / dst_channels;
+        int c= i % dst_channels;
+        bool used= (x < step);
+        shuffle[i]= (used && offsets[c] >= 0) ? (char) (x * src_bpp + offsets[c]) : (char) 0x80;
+        alpha[i]= (used && offsets[c] < 0) ? (char) 0xFF : 0;
+    }
+    const __m128i mask= _mm_load_si128((const __m128i *) shuffle);
+    const __m128i fill= _mm_load_si128((const __m128i *) alpha);
+
+    int x= 0;
+    // les 16 octets lus et ecrits restent dans la ligne
+    for(; (x * src_bpp + 16 <= width * src_bpp) && (x * dst_channels + 16 <= width * dst_channels); x+= step)
+    {
+        __m128i pixels= _mm_loadu_si128((const __m128i *) (src + x * src_bpp));
+        pixels= _mm_or_si128(_mm_shuffle_epi8(pixels, mask), fill);
+        _mm_storeu_si128((__m128i *) (dst + x * dst_channels), pixels);
+    }
+    return x;
+}
+
+// 8 bits vers float, meme resultat que la division scalaire
+static int float_row_sse2( const unsigned char *src, float *dst, const int n )
+{
+    const __m128 scale= _mm_set1_ps(255.f);
+    const __m128i zero= _mm_setzero_si128();
+    int i= 0;
+    for(; i + 16 <= n; i+= 16)
+    {
+        __m128i v= _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i lo= _mm_unpacklo_epi8(v, zero);
+        __m128i hi= _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(dst + i,      _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+        _mm_storeu_ps(dst + i + 4,  _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+        _mm_storeu_ps(dst + i + 8,  _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+        _mm_storeu_ps(dst + i + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static int float_row_avx2( const unsigned char *src, float *dst, const int n )
+{
+    const __m256 scale= _mm256_set1_ps(255.f);
+    int i= 0;
+    for(; i + 16 <= n; i+= 16)
+    {
+        __m256i lo= _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (src + i)));
+        __m256i hi= _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (src + i + 8)));
+        _mm256_storeu_ps(dst + i,     _mm256_div_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_div_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    return i;
+}
+
+// float vers 8 bits : clamp avant la troncature, qui vaut floor( ) pour les valeurs positives. max(nan, 0) = 0
+static int byte_row_sse2( const float *src, unsigned char *dst, const int n )
+{
+    const __m128 scale= _mm_set1_ps(255.f);
+    const __m128 zero= _mm_setzero_ps();
+    int i= 0;
+    for(; i + 16 <= n; i+= 16)
+    {
+        __m128i v[4];
+        for(int k= 0; k < 4; k++)
+        {
+            __m128 f= _mm_mul_ps(_mm_loadu_ps(src + i + 4*k), scale);
+            f= _mm_min_ps(_mm_max_ps(f, zero), scale);
+            v[k]= _mm_cvttps_epi32(f);
+        }
+        __m128i lo= _mm_packs_epi32(v[0], v[1]);
+        __m128i hi= _mm_packs_epi32(v[2], v[3]);
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static int byte_row_avx2( const float *src, unsigned char *dst, const int n )
+{
+    const __m256 scale= _mm256_set1_ps(255.f);
+    const __m256 zero= _mm256_setzero_ps();
+    const __m256i order= _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i= 0;
+    for(; i + 32 <= n; i+= 32)
+    {
+        __m256i v[4];
+        for(int k= 0; k < 4; k++)
+        {
+            __m256 f= _mm256_mul_ps(_mm256_loadu_ps(src + i + 8*k), scale);
+            f= _mm256_min_ps(_mm256_max_ps(f, zero), scale);
+            v[k]= _mm256_cvttps_epi32(f);
+        }
+        // les pack travaillent sur chaque moitie du registre, remet les pixels dans l'ordre
+        __m256i lo= _mm256_packs_epi32(v[0], v[1]);
+        __m256i hi= _mm256_packs_epi32(v[2], v[3]);
+        __m256i bytes= _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order);
+        _mm256_storeu_si256((__m256i *) (dst + i), bytes);
+    }
+    return i;
+}
+#endif
+
+
+void convert_pixels( const unsigned char *src, const int src_pitch, const int src_bpp, const int src_offsets[4],
+    unsigned char *dst, const int dst_pitch, const int dst_channels, const int width, const int height, const bool flip )
+{
+    parallel_rows(width, height,
+        [=]( const int begin, const int end )
+        {
+            for(int y= begin; y < end; y++)
+            {
+                const unsigned char *row= src + size_t(flip ? height -1 - y : y) * src_pitch;
+                unsigned char *line= dst + size_t(y) * dst_pitch;
+
+                int x= 0;
+            #ifdef GK_IMAGE_SIMD
+                if(cpu_ssse3())
+                    x= swizzle_row_ssse3(row, src_bpp, src_offsets, line, dst_channels, width);
+            #endif
+                swizzle_row(row, src_bpp, src_offsets, line, dst_channels, x, width);
+            }
+        });
+}
+
+void convert_pixels( const unsigned char *src, const int src_pitch, const int src_bpp, const int src_offsets[4],
+    float *dst, const int width, const int height, const bool flip )
+{
+    parallel_rows(width, height,
+        [=]( const int begin, const int end )
+        {
+            // reordonne les canaux dans une ligne temporaire, puis convertit
+            std::vector<unsigned char> tmp(size_t(width) * 4);
+            for(int y= begin; y < end; y++)
+            {
+                const unsigned char *row= src + size_t(flip ? height -1 - y : y) * src_pitch;
+                float *line= dst + size_t(y) * width * 4;
+
+                int x= 0;
+            #ifdef GK_IMAGE_SIMD
+                if(cpu_ssse3())
+                    x= swizzle_row_ssse3(row, src_bpp, src_offsets, tmp.data(), 4, width);
+            #endif
+                swizzle_row(row, src_bpp, src_offsets, tmp.data(), 4, x, width);
+
+                int i= 0;
+            #ifdef GK_IMAGE_SIMD
+                i= cpu_avx2() ? float_row_avx2(tmp.data(), line, width * 4) : float_row_sse2(tmp.data(), line, width * 4);
+            #endif
+                float_row(tmp.data(), line, i, width * 4);
+            }
+        });
+}
+
+void convert_pixels( const float *src, unsigned char *dst, const int width, const int height, const bool flip )
+{
+    parallel_rows(width, height,
+        [=]( const int begin, const int end )
+        {
+            for(int y= begin; y < end; y++)
+            {
+                const float *row= src + size_t(flip ? height -1 - y : y) * width * 4;
+                unsigned char *line= dst + size_t(y) * width * 4;
+
+                int i= 0;
+            #ifdef GK_IMAGE_SIMD
+                i= cpu_avx2() ? byte_row_avx2(row, line, width * 4) : byte_row_sse2(row, line, width * 4);
+            #endif
+                byte_row(row, line, i, width * 4);
+            }
+        });
+}
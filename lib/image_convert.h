@@ -0,0 +1,33 @@
+#ifndef _IMAGE_CONVERT_H
+#define _IMAGE_CONVERT_H
+
+
+//! \addtogroup image utilitaires pour manipuler des images
+///@{
+
+/*! \file
+conversion des pixels, utilisee par read_image( ), write_image( ), read_image_data( ) et write_image_data( ) :
+    - reordonne les canaux 8 bits (surfaces sdl bgr, bgra, etc.),
+    - 8 bits vers float, float vers 8 bits,
+    - retourne l'image, si necessaire (origine en bas a gauche pour openGL).
+
+les lignes sont converties en parallele, par des instructions sse / avx2 quand le processeur les supporte.
+ */
+
+/*! copie des pixels 8 bits, en reordonnant les canaux.
+    src_offsets[c] est la position du canal c (r, g, b, a) dans un pixel de src, ou -1 si le canal n'existe pas (il vaut 255).
+    src_bpp, dst_channels : nombre d'octets par pixel, 3 ou 4. les lignes de src sont separees par src_pitch octets, celles de dst par dst_pitch octets.
+    flip : la ligne y de dst est la ligne height -1 -y de src.
+ */
+void convert_pixels( const unsigned char *src, const int src_pitch, const int src_bpp, const int src_offsets[4],
+    unsigned char *dst, const int dst_pitch, const int dst_channels, const int width, const int height, const bool flip );
+
+//! copie des pixels 8 bits, cf convert_pixels( ), vers des pixels rgba float, v / 255.
+void convert_pixels( const unsigned char *src, const int src_pitch, const int src_bpp, const int src_offsets[4],
+    float *dst, const int width, const int height, const bool flip );
+
+//! copie des pixels rgba float vers des pixels rgba 8 bits, floor(v * 255), entre 0 et 255.
+void convert_pixels( const float *src, unsigned char *dst, const int width, const int height, const bool flip );
+
+///@}
+#endif
@@ -2,6 +2,7 @@
 #include <string>
 
 #include "rgbe.h"
+#include "mapped_file.h"
 #include "image_hdr.h"
 
 
@@ -29,28 +30,27 @@ Image read_image_hdr( const char *filename )
         return Image::error();
     }
 
-    std::vector<float> data(width*height*3, 0.f);
-    if(RGBE_ReadPixels_RLE(in, &data.front(), width, height) != RGBE_RETURN_SUCCESS)
+    // les pixels suivent l'entete
+    long offset= ftell(in);
+    fclose(in);
+
+    MappedFile file;
+    if(offset < 0 || !file.open(filename) || (size_t) offset > file.size)
     {
-        fclose(in);
         printf("[error] loading hdr image '%s'...\n", filename);
         return Image::error();
     }
 
-    fclose(in);
-    
-    // 
-    printf("loading hdr image '%s' %dx%d...\n", filename, width, height);
+    // decode directement dans l'image, rgba, origine en bas a gauche
     Image image(width, height);
-    
-    int i= 0;
-    for(int y= 0; y < height; y++)
-    for(int x= 0; x < width; x++)
+    if(RGBE_DecodePixels_RLE((const unsigned char *) file.data + offset, file.size - offset,
+        (float *) &image(0, 0), 4, width, height, 1) != RGBE_RETURN_SUCCESS)
     {
-        image(x, height - y -1)= Color(data[i], data[i+1], data[i+2]);
-        i= i + 3;
+        printf("[error] loading hdr image '%s'...\n", filename);
+        return Image::error();
     }
-    
+
+    printf("loading hdr image '%s' %dx%d...\n", filename, width, height);
     return image;
 }
 
@@ -76,19 +76,8 @@ int write_image_hdr( const Image& image, const char *filename )
         return -1;
     }
 
-    std::vector<float> data(width*height*3, 0.f);
-    int i= 0;
-    for(int y= 0; y < height; y++)
-    for(int x= 0; x < width; x++)
-    {
-        Color color= image(x, height - y -1);
-        data[i]= color.r;
-        data[i+1]= color.g;
-        data[i+2]= color.b;
-        i= i + 3;
-    }
-
-    int code= RGBE_WritePixels_RLE(out, &data.front(), width, height);
+    // encode directement les pixels rgba de l'image, premiere ligne en haut
+    int code= RGBE_EncodePixels_RLE(out, (const float *) image.buffer(), 4, width, height, 1);
     fclose(out);
 
     if(code != RGBE_RETURN_SUCCESS)
@@ -11,8 +11,19 @@
 #endif
 
 #include "image_io.h"
+#include "image_convert.h"
 
 
+// position des canaux r, g, b, a dans un pixel de la surface, -1 si le canal n'existe pas.
+static
+void surface_offsets( const SDL_PixelFormat& format, int offsets[4] )
+{
+    offsets[0]= format.Rshift / 8;
+    offsets[1]= format.Gshift / 8;
+    offsets[2]= format.Bshift / 8;
+    offsets[3]= (format.BitsPerPixel == 32) ? format.Ashift / 8 : -1;
+}
+
 Image read_image( const char *filename )
 {
     // importer le fichier en utilisant SDL_image
@@ -41,44 +52,11 @@ Image read_image( const char *filename )
     printf("loading image '%s' %dx%d %d channels...\n", filename, width, height, channels);
 
     // converti les donnees en pixel rgba, et retourne l'image, origine en bas a gauche.
-    if(format.BitsPerPixel == 32)
-    {
-        int py= 0;
-        for(int y= height -1; y >= 0; y--, py++)
-        {
-            Uint8 *pixel= (Uint8 *) surface->pixels + py * surface->pitch;
-
-            for(int x= 0; x < width; x++)
-            {
-                Uint8 r= pixel[format.Rshift / 8];
-                Uint8 g= pixel[format.Gshift / 8];
-                Uint8 b= pixel[format.Bshift / 8];
-                Uint8 a= pixel[format.Ashift / 8];
-
-                image(x, y)= Color((float) r / 255.f, (float) g / 255.f, (float) b / 255.f, (float) a / 255.f);
-                pixel= pixel + format.BytesPerPixel;
-            }
-        }
-    }
-
-    else if(format.BitsPerPixel == 24)
-    {
-        int py= 0;
-        for(int y= height -1; y >= 0; y--, py++)
-        {
-            Uint8 *pixel= (Uint8 *) surface->pixels + py * surface->pitch;
-
-            for(int x= 0; x < surface->w; x++)
-            {
-                const Uint8 r= pixel[format.Rshift / 8];
-                const Uint8 g= pixel[format.Gshift / 8];
-                const Uint8 b= pixel[format.Bshift / 8];
-
-                image(x, y)= Color((float) r / 255.f, (float) g / 255.f, (float) b / 255.f);
-                pixel= pixel + format.BytesPerPixel;
-            }
-        }
-    }
+    int offsets[4];
+    surface_offsets(format, offsets);
+    if(image.size() > 0)
+        convert_pixels((const unsigned char *) surface->pixels, surface->pitch, format.BytesPerPixel, offsets,
+            (float *) &image(0, 0), width, height, true);
 
     SDL_FreeSurface(surface);
     return image;
@@ -95,23 +73,7 @@ int write_image( const Image& image, const char *filename )
 
     // flip de l'image : Y inverse entre GL et BMP
     std::vector<Uint8> flip(image.width() * image.height() * 4);
-
-    int p= 0;
-    for(int y= 0; y < image.height(); y++)
-    for(int x= 0; x < image.width(); x++)
-    {
-        Color color= image(x, image.height() - y -1);
-        Uint8 r= (Uint8) std::min(std::floor(color.r * 255.f), 255.f);
-        Uint8 g= (Uint8) std::min(std::floor(color.g * 255.f), 255.f);
-        Uint8 b= (Uint8) std::min(std::floor(color.b * 255.f), 255.f);
-        Uint8 a= (Uint8) std::min(std::floor(color.a * 255.f), 255.f);
-
-        flip[p]= r;
-        flip[p +1]= g;
-        flip[p +2]= b;
-        flip[p +3]= a;
-        p= p + 4;
-    }
+    convert_pixels((const float *) image.buffer(), &flip.front(), image.width(), image.height(), true);
 
     SDL_Surface *surface= SDL_CreateRGBSurfaceFrom((void *) &flip.front(), image.width(), image.height(),
         32, image.width() * 4,
@@ -169,51 +131,10 @@ ImageData read_image_data( const char *filename )
     printf("loading image '%s' %dx%d %d channels...\n", filename, width, height, channels);
 
     // converti les donnees en pixel rgba, et retourne l'image, origine en bas a gauche.
-    if(format.BitsPerPixel == 32)
-    {
-        int py= 0;
-        for(int y= height -1; y >= 0; y--, py++)
-        {
-            Uint8 *pixel= (Uint8 *) surface->pixels + py * surface->pitch;
-
-            for(int x= 0; x < width; x++)
-            {
-                Uint8 r= pixel[format.Rshift / 8];
-                Uint8 g= pixel[format.Gshift / 8];
-                Uint8 b= pixel[format.Bshift / 8];
-                Uint8 a= pixel[format.Ashift / 8];
-
-                std::size_t offset= image.offset(x, y);
-                image.data[offset]= r;
-                image.data[offset +1]= g;
-                image.data[offset +2]= b;
-                image.data[offset +3]= a;
-                pixel= pixel + format.BytesPerPixel;
-            }
-        }
-    }
-
-    else if(format.BitsPerPixel == 24)
-    {
-        int py= 0;
-        for(int y= height -1; y >= 0; y--, py++)
-        {
-            Uint8 *pixel= (Uint8 *) surface->pixels + py * surface->pitch;
-
-            for(int x= 0; x < surface->w; x++)
-            {
-                const Uint8 r= pixel[format.Rshift / 8];
-                const Uint8 g= pixel[format.Gshift / 8];
-                const Uint8 b= pixel[format.Bshift / 8];
-
-                std::size_t offset= image.offset(x, y);
-                image.data[offset]= r;
-                image.data[offset +1]= g;
-                image.data[offset +2]= b;
-                pixel= pixel + format.BytesPerPixel;
-            }
-        }
-    }
+    int offsets[4];
+    surface_offsets(format, offsets);
+    convert_pixels((const unsigned char *) surface->pixels, surface->pitch, format.BytesPerPixel, offsets,
+        (unsigned char *) image.buffer(), width * channels, channels, width, height, true);
 
     SDL_FreeSurface(surface);
     return image;
@@ -235,25 +156,9 @@ int write_image_data( ImageData& image, const char *filename )
 
     // flip de l'image : origine en bas a gauche
     std::vector<Uint8> flip(image.width * image.height * 4);
-
-    int p= 0;
-    for(int y= 0; y < image.height; y++)
-    for(int x= 0; x < image.width; x++)
-    {
-        std::size_t offset= image.offset(x, image.height - y -1);
-        Uint8 r= image.data[offset];
-        Uint8 g= image.data[offset +1];
-        Uint8 b= image.data[offset +2];
-        Uint8 a= 255;
-        if(image.channels > 3)
-            a= image.data[offset +3];
-
-        flip[p]= r;
-        flip[p +1]= g;
-        flip[p +2]= b;
-        flip[p +3]= a;
-        p= p + 4;
-    }
+    const int offsets[4]= { 0, 1, 2, (image.channels > 3) ? 3 : -1 };
+    convert_pixels((const unsigned char *) image.buffer(), image.width * image.channels, image.channels, offsets,
+        &flip.front(), image.width * 4, 4, image.width, image.height, true);
 
     // construit la surface sdl
     SDL_Surface *surface= SDL_CreateRGBSurfaceFrom((void *) &flip.front(), image.width, image.height,
@@ -0,0 +1,248 @@
+#ifndef _IMAGE_TYPED_H
+#define _IMAGE_TYPED_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+#include "glcore.h"
+#include "color.h"
+#include "image.h"
+#include "image_io.h"
+#include "half.h"
+
+
+//! \addtogroup image utilitaires pour manipuler des images
+///@{
+
+/*! \file
+images compactes : N canaux (1 a 4) de type T par pixel, uint8_t, uint16_t, Half ou float.
+une image 8 bits rgba occupe 4 octets par pixel, au lieu des 16 octets de Image, et se transfere telle quelle dans une texture, cf make_texture( ).
+
+\code
+ImageRGBA8 image(read_image_data("data/font.png"));
+Color c= image.color(0, 0);                     // vue en float, conversion a la lecture
+image.color(0, 0, Color(1, 0, 0));              // conversion a l'ecriture
+GLuint texture= make_texture(0, image);         // GL_RGBA8, pas de conversion
+\endcode
+ */
+
+//! half float, 16 bits, cf float_to_half( ).
+struct Half
+{
+    uint16_t bits;
+};
+
+//! conversions entre le type des canaux et float, format des textures.
+template < typename T > struct ImageChannel;
+
+template < > struct ImageChannel<uint8_t>
+{
+    static GLenum type( ) { return GL_UNSIGNED_BYTE; }
+    static float to_float( const uint8_t v ) { return (float) v / 255.f; }
+    static uint8_t from_float( const float f )
+    {
+        float v= std::floor(f * 255.f);
+        return (v > 0) ? (uint8_t) std::min(v, 255.f) : 0;
+    }
+};
+
+template < > struct ImageChannel<uint16_t>
+{
+    static GLenum type( ) { return GL_UNSIGNED_SHORT; }
+    static float to_float( const uint16_t v ) { return (float) v / 65535.f; }
+    static uint16_t from_float( const float f )
+    {
+        float v= std::floor(f * 65535.f);
+        return (v > 0) ? (uint16_t) std::min(v, 65535.f) : 0;
+    }
+};
+
+template < > struct ImageChannel<Half>
+{
+    static GLenum type( ) { return GL_HALF_FLOAT; }
+    static float to_float( const Half v ) { return half_to_float(v.bits); }
+    static Half from_float( const float f ) { Half h; h.bits= float_to_half(f); return h; }
+};
+
+template < > struct ImageChannel<float>
+{
+    static GLenum type( ) { return GL_FLOAT; }
+    static float to_float( const float v ) { return v; }
+    static float from_float( const float f ) { return f; }
+};
+
+//! format interne des textures, meme precision que l'image.
+template < typename T, int N > GLenum image_texel_format( );
+
+template < > inline GLenum image_texel_format<uint8_t, 1>( ) { return GL_R8; }
+template < > inline GLenum image_texel_format<uint8_t, 2>( ) { return GL_RG8; }
+template < > inline GLenum image_texel_format<uint8_t, 3>( ) { return GL_RGB8; }
+template < > inline GLenum image_texel_format<uint8_t, 4>( ) { return GL_RGBA8; }
+template < > inline GLenum image_texel_format<uint16_t, 1>( ) { return GL_R16; }
+template < > inline GLenum image_texel_format<uint16_t, 2>( ) { return GL_RG16; }
+template < > inline GLenum image_texel_format<uint16_t, 3>( ) { return GL_RGB16; }
+template < > inline GLenum image_texel_format<uint16_t, 4>( ) { return GL_RGBA16; }
+template < > inline GLenum image_texel_format<Half, 1>( ) { return GL_R16F; }
+template < > inline GLenum image_texel_format<Half, 2>( ) { return GL_RG16F; }
+template < > inline GLenum image_texel_format<Half, 3>( ) { return GL_RGB16F; }
+template < > inline GLenum image_texel_format<Half, 4>( ) { return GL_RGBA16F; }
+template < > inline GLenum image_texel_format<float, 1>( ) { return GL_R32F; }
+template < > inline GLenum image_texel_format<float, 2>( ) { return GL_RG32F; }
+template < > inline GLenum image_texel_format<float, 3>( ) { return GL_RGB32F; }
+template < > inline GLenum image_texel_format<float, 4>( ) { return GL_RGBA32F; }
+
+
+//! image de N canaux de type T par pixel.
+template < typename T, int N >
+class TypedImage
+{
+    static_assert(N >= 1 && N <= 4, "1 to 4 channels");
+
+protected:
+    std::vector<T> m_data;
+    int m_width;
+    int m_height;
+
+    std::size_t offset( const int x, const int y ) const
+    {
+        return (std::size_t(std::min(y, m_height-1)) * m_width + std::min(x, m_width-1)) * N;
+    }
+
+public:
+    typedef T channel_type;
+    static const int channels= N;
+
+    TypedImage( ) : m_data(), m_width(0), m_height(0) {}
+    TypedImage( const int w, const int h ) : m_data(std::size_t(w) * h * N), m_width(w), m_height(h) {}
+    TypedImage( const int w, const int h, const Color& color ) : m_data(std::size_t(w) * h * N), m_width(w), m_height(h)
+    {
+        for(int y= 0; y < h; y++)
+        for(int x= 0; x < w; x++)
+            this->color(x, y, color);
+    }
+
+    //! conversion d'une image float, cf read_image( ).
+    explicit TypedImage( const Image& image ) : m_data(image.size() * N), m_width(image.width()), m_height(image.height())
+    {
+        for(int y= 0; y < m_height; y++)
+        for(int x= 0; x < m_width; x++)
+            color(x, y, image(x, y));
+    }
+
+    //! conversion des donnees d'une image, cf read_image_data( ). copie directe si les canaux sont identiques.
+    //! canaux de 1 octet : uint8_t, 2 octets : uint16_t, 4 octets : float, comme make_texture( ).
+    explicit TypedImage( const ImageData& image ) : m_data(std::size_t(image.width) * image.height * N), m_width(image.width), m_height(image.height)
+    {
+        if(image.data.empty())
+            return;
+        assert(image.size == 1 || image.size == 2 || image.size == 4);
+
+        // 2 octets par canal : uint16_t, pas half float
+        if(image.channels == N && image.size == (int) sizeof(T) && !std::is_same<T, Half>::value)
+        {
+            memcpy(m_data.data(), image.buffer(), m_data.size() * sizeof(T));
+            return;
+        }
+
+        // canal absent : 0, alpha absent : 1
+        for(int y= 0; y < m_height; y++)
+        for(int x= 0; x < m_width; x++)
+        {
+            const unsigned char *pixel= image.data.data() + (std::size_t(y) * m_width + x) * image.channels * image.size;
+            float v[4]= { 0, 0, 0, 1 };
+            for(int c= 0; c < std::min(image.channels, 4); c++)
+            {
+                if(image.size == 1)
+                    v[c]= (float) pixel[c] / 255.f;
+                else if(image.size == 2)
+                {
+                    uint16_t value;
+                    memcpy(&value, pixel + c * 2, sizeof(uint16_t));
+                    v[c]= (float) value / 65535.f;
+                }
+                else if(image.size == 4)
+                    memcpy(&v[c], pixel + c * 4, sizeof(float));
+            }
+            color(x, y, Color(v[0], v[1], v[2], v[3]));
+        }
+    }
+
+    //! renvoie un pointeur sur les N canaux d'un pixel.
+    T *operator() ( const int x, const int y ) { return &m_data[offset(x, y)]; }
+    //! renvoie un pointeur sur les N canaux d'un pixel (image non modifiable).
+    const T *operator() ( const int x, const int y ) const { return &m_data[offset(x, y)]; }
+
+    //! renvoie la couleur d'un pixel, convertie en float. canal absent : 0, alpha absent : 1.
+    Color color( const int x, const int y ) const
+    {
+        const T *pixel= (*this)(x, y);
+        float v[4]= { 0, 0, 0, 1 };
+        for(int c= 0; c < N; c++)
+            v[c]= ImageChannel<T>::to_float(pixel[c]);
+        return Color(v[0], v[1], v[2], v[3]);
+    }
+
+    //! modifie la couleur d'un pixel, convertie dans le type de l'image.
+    TypedImage& color( const int x, const int y, const Color& color )
+    {
+        T *pixel= (*this)(x, y);
+        const float v[4]= { color.r, color.g, color.b, color.a };
+        for(int c= 0; c < N; c++)
+            pixel[c]= ImageChannel<T>::from_float(v[c]);
+        return *this;
+    }
+
+    //! renvoie une image float, cf write_image( ).
+    Image image( ) const
+    {
+        Image converted(m_width, m_height);
+        for(int y= 0; y < m_height; y++)
+        for(int x= 0; x < m_width; x++)
+            converted(x, y)= color(x, y);
+        return converted;
+    }
+
+    //! renvoie un pointeur sur le stockage des pixels.
+    const void *buffer( ) const
+    {
+        assert(!m_data.empty());
+        return m_data.data();
+    }
+
+    //! renvoie la largeur de l'image.
+    int width( ) const { return m_width; }
+    //! renvoie la hauteur de l'image.
+    int height( ) const { return m_height; }
+    //! renvoie le nombre de pixels de l'image.
+    std::size_t size( ) const { return std::size_t(m_width) * m_height; }
+    //! renvoie la taille de l'image en octets.
+    std::size_t bytes( ) const { return m_data.size() * sizeof(T); }
+
+    //! format des donnees, cf glTexImage2D( ).
+    static GLenum data_format( )
+    {
+        const GLenum formats[4]= { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+        return formats[N -1];
+    }
+    //! type des donnees, cf glTexImage2D( ).
+    static GLenum data_type( ) { return ImageChannel<T>::type(); }
+    //! format interne des textures.
+    static GLenum texel_format( ) { return image_texel_format<T, N>(); }
+};
+
+typedef TypedImage<uint8_t, 1> ImageR8;
+typedef TypedImage<uint8_t, 3> ImageRGB8;
+typedef TypedImage<uint8_t, 4> ImageRGBA8;
+typedef TypedImage<uint16_t, 1> ImageR16;
+typedef TypedImage<uint16_t, 4> ImageRGBA16;
+typedef TypedImage<Half, 4> ImageRGBA16F;
+typedef TypedImage<float, 1> ImageR32F;
+typedef TypedImage<float, 4> ImageRGBA32F;
+
+///@}
+#endif
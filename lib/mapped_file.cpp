@@ -0,0 +1,62 @@
+
+#include <cstdio>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_file.h"
+
+
+bool MappedFile::open( const char *filename )
+{
+#ifndef WIN32
+    int fd= ::open(filename, O_RDONLY);
+    if(fd < 0)
+        return false;
+    
+    struct stat info;
+    if(fstat(fd, &info) < 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    
+    size= (size_t) info.st_size;
+    if(size > 0)
+    {
+        void *map= mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map != MAP_FAILED)
+        {
+            madvise(map, size, MADV_SEQUENTIAL);
+            data= (const char *) map;
+        }
+    }
+    ::close(fd);
+    if(size == 0 || data != NULL)
+        return true;
+#endif
+    
+    FILE *in= fopen(filename, "rb");
+    if(in == NULL)
+        return false;
+    
+    fseek(in, 0, SEEK_END);
+    copy.resize(ftell(in));
+    fseek(in, 0, SEEK_SET);
+    size= fread(copy.data(), 1, copy.size(), in);
+    fclose(in);
+    data= copy.data();
+    return true;
+}
+
+MappedFile::~MappedFile( )
+{
+#ifndef WIN32
+    if(data != NULL && copy.empty())
+        munmap((void *) data, size);
+#endif
+}
@@ -0,0 +1,33 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <cstddef>
+#include <vector>
+
+
+//! \addtogroup utilitaires
+///@{
+
+//! \file
+//! fichier projete en memoire, pour les lecteurs de fichiers, cf read_mesh( ) et read_image_hdr( ).
+
+//! fichier projete en memoire, en lecture seule, ou charge completement s'il ne peut pas etre projete.
+struct MappedFile
+{
+    const char *data;
+    std::size_t size;
+    std::vector<char> copy;
+    
+    MappedFile( ) : data(NULL), size(0), copy() {}
+    ~MappedFile( );
+    
+    //! projette le fichier. renvoie false en cas d'echec.
+    bool open( const char *filename );
+    
+private:
+    MappedFile( const MappedFile& );
+    MappedFile& operator= ( const MappedFile& );
+};
+
+///@}
+#endif
@@ -1,14 +1,17 @@
 
 #include <cstdio>
 #include <cassert>
+#include <cstdint>
 #include <string>
 #include <algorithm>
 
 #include "vec.h"
 #include "mesh.h"
+#include "mesh_optimize.h"
 
 #include "program.h"
 #include "uniforms.h"
+#include "state.h"
 
 #include "window.h"
 
@@ -21,14 +24,13 @@ int Mesh::create( const GLenum primitives )
 
 void Mesh::release( )
 {
-    glDeleteVertexArrays(1, &m_vao);
-    glDeleteBuffers(1, &m_buffer);
-    glDeleteBuffers(1, &m_index_buffer);
+    // pas d'appel openGL si les buffers n'ont jamais ete crees, cf release_buffers( )
+    release_buffers();
 
     // detruit tous les shaders crees...
     for(auto it= m_state_map.begin(); it != m_state_map.end(); ++it)
         if(it->second > 0)
-            release_program(it->second);
+            release_shared_program(it->second);
 }
 
 // definit les attributs du prochain sommet
@@ -38,6 +40,26 @@ Mesh& Mesh::default_color( const Color& color )
     return *this;
 }
 
+Mesh& Mesh::vertex_format( const VertexFormat& format )
+{
+    if(format == m_format)
+        return *this;
+    m_format= format;
+    
+    if(m_vao == 0)
+        // pas encore de buffers, ni de shaders
+        return *this;
+    
+    // reconstruit les buffers et les shaders au prochain draw
+    release_buffers();
+    for(auto it= m_state_map.begin(); it != m_state_map.end(); ++it)
+        if(it->second > 0)
+            release_shared_program(it->second);
+    m_state_map.clear();
+    m_program= 0;
+    return *this;
+}
+
 Mesh& Mesh::color( const vec4& color )
 {
     m_colors.push_back(color);
@@ -56,6 +78,224 @@ Mesh& Mesh::texcoord( const vec2& uv )
     return *this;
 }
 
+Mesh& Mesh::reserve( const unsigned int vertices, const unsigned int indices )
+{
+    m_positions.reserve(vertices);
+    if(m_texcoords.size() > 0) m_texcoords.reserve(vertices);
+    if(m_normals.size() > 0) m_normals.reserve(vertices);
+    if(m_colors.size() > 0) m_colors.reserve(vertices);
+    m_indices.reserve(indices);
+    return *this;
+}
+
+Mesh& Mesh::adopt_positions( std::vector<vec3>&& positions )
+{
+    m_positions= std::move(positions);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::adopt_texcoords( std::vector<vec2>&& texcoords )
+{
+    m_texcoords= std::move(texcoords);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::adopt_normals( std::vector<vec3>&& normals )
+{
+    m_normals= std::move(normals);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::adopt_colors( std::vector<vec4>&& colors )
+{
+    m_colors= std::move(colors);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::adopt_indices( std::vector<unsigned int>&& indices )
+{
+    m_indices= std::move(indices);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::adopt_materials( std::vector<unsigned int>&& materials )
+{
+    m_triangle_materials= std::move(materials);
+    return *this;
+}
+
+Mesh& Mesh::adopt( Mesh&& mesh )
+{
+    if(&mesh == this)
+        return *this;
+    
+    m_positions= std::move(mesh.m_positions);
+    m_texcoords= std::move(mesh.m_texcoords);
+    m_normals= std::move(mesh.m_normals);
+    m_colors= std::move(mesh.m_colors);
+    m_indices= std::move(mesh.m_indices);
+    m_materials= std::move(mesh.m_materials);
+    m_triangle_materials= std::move(mesh.m_triangle_materials);
+    m_primitives= mesh.m_primitives;
+    
+    // les vecteurs deplaces ne sont pas forcement vides
+    mesh.m_positions.clear();
+    mesh.m_texcoords.clear();
+    mesh.m_normals.clear();
+    mesh.m_colors.clear();
+    mesh.m_indices.clear();
+    mesh.m_materials.clear();
+    mesh.m_triangle_materials.clear();
+    
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::append_positions( const vec3 *positions, const size_t n )
+{
+    m_positions.insert(m_positions.end(), positions, positions + n);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::append_texcoords( const vec2 *texcoords, const size_t n )
+{
+    m_texcoords.insert(m_texcoords.end(), texcoords, texcoords + n);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::append_normals( const vec3 *normals, const size_t n )
+{
+    m_normals.insert(m_normals.end(), normals, normals + n);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::append_colors( const vec4 *colors, const size_t n )
+{
+    m_colors.insert(m_colors.end(), colors, colors + n);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::append_indices( const unsigned int *indices, const size_t n, const unsigned int base )
+{
+    m_indices.reserve(m_indices.size() + n);
+    for(size_t i= 0; i < n; i++)
+        m_indices.push_back(indices[i] + base);
+    release_buffers();
+    return *this;
+}
+
+Mesh& Mesh::constant_color( const Color& color )
+{
+    // shaders : mesh_color au lieu de l'attribut color, cf data/mesh.glsl
+    std::vector<vec4>().swap(m_colors);
+    m_color= color;
+    release_buffers();
+    return *this;
+}
+
+void Mesh::release_buffers( )
+{
+    if(m_vao == 0)
+        return;
+    
+    state_delete_vertex_arrays(1, &m_vao);
+    glDeleteBuffers(1, &m_buffer);
+    glDeleteBuffers(1, &m_index_buffer);
+    m_vao= 0;
+    m_buffer= 0;
+    m_index_buffer= 0;
+}
+
+// renumerote les sommets, remap[i] nouvel indice du sommet i, ou ~0u pour le supprimer
+template < typename T >
+static void remap_attributes( std::vector<T>& attributes, const std::vector<unsigned int>& remap, const unsigned int count )
+{
+    if(attributes.size() != remap.size())
+    {
+        // attribut incomplet, pas utilise par draw( )
+        attributes.clear();
+        return;
+    }
+    
+    std::vector<T> tmp(count);
+    for(unsigned int i= 0; i < (unsigned int) remap.size(); i++)
+        if(remap[i] != ~0u)
+            tmp[remap[i]]= attributes[i];
+    attributes.swap(tmp);
+}
+
+Mesh& Mesh::optimize( )
+{
+    if(m_primitives != GL_TRIANGLES || m_positions.size() == 0)
+        return *this;
+    
+    std::vector<unsigned int> indices;
+    indices.swap(m_indices);
+    if(indices.size() == 0)
+    {
+        // triangles non indexes : 1 sommet par coin
+        indices.resize(m_positions.size());
+        for(unsigned int i= 0; i < (unsigned int) indices.size(); i++)
+            indices[i]= i;
+    }
+    
+    // les attributs incomplets ne sont pas utilises par draw( ), cf remap_attributes( )
+    if(m_texcoords.size() != m_positions.size())
+        std::vector<vec2>().swap(m_texcoords);
+    if(m_normals.size() != m_positions.size())
+        std::vector<vec3>().swap(m_normals);
+    if(m_colors.size() != m_positions.size())
+        std::vector<vec4>().swap(m_colors);
+    
+    // soude les sommets identiques
+    std::vector<unsigned int> remap;
+    unsigned int count= weld_vertices(m_positions, m_texcoords, m_normals, m_colors, remap);
+    for(unsigned int i= 0; i < (unsigned int) indices.size(); i++)
+        indices[i]= remap[indices[i]];
+    
+    // reordonne les triangles, et leurs matieres
+    std::vector<unsigned int> order;
+    optimize_vertex_cache(indices, count, order);
+    
+    std::vector<unsigned int> triangles(indices.size());
+    for(unsigned int i= 0; i < (unsigned int) order.size(); i++)
+        for(int k= 0; k < 3; k++)
+            triangles[3*i + k]= indices[3*order[i] + k];
+    
+    if(m_triangle_materials.size() == order.size())
+    {
+        std::vector<unsigned int> materials(order.size());
+        for(unsigned int i= 0; i < (unsigned int) order.size(); i++)
+            materials[i]= m_triangle_materials[order[i]];
+        m_triangle_materials.swap(materials);
+    }
+    
+    // renumerote les sommets dans l'ordre d'utilisation, les deux renumerotations sont composees
+    std::vector<unsigned int> fetch;
+    count= optimize_vertex_fetch(triangles, count, fetch);
+    for(unsigned int i= 0; i < (unsigned int) remap.size(); i++)
+        remap[i]= (remap[i] != ~0u) ? fetch[remap[i]] : ~0u;
+    
+    // les sommets soudes ont les memes attributs, ils sont copies au meme endroit
+    remap_attributes(m_texcoords, remap, count);
+    remap_attributes(m_normals, remap, count);
+    remap_attributes(m_colors, remap, count);
+    remap_attributes(m_positions, remap, count);
+    m_indices.swap(triangles);
+    
+    release_buffers();
+    return *this;
+}
+
 // insere un nouveau sommet
 unsigned int Mesh::vertex( const vec3& position )
 {
@@ -151,7 +391,7 @@ Mesh& Mesh::restart_strip( )
     m_indices.push_back(~0u);   // ~0u plus grand entier non signe representable
 #if 1
     glPrimitiveRestartIndex(~0u);
-    glEnable(GL_PRIMITIVE_RESTART);
+    state_enable(GL_PRIMITIVE_RESTART);
 #else
     glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX); // n'existe pas sur mac ?!
 #endif
@@ -303,60 +543,48 @@ GLuint Mesh::create_buffers( const bool use_texcoord, const bool use_normal, con
 #endif
     
     glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
+    state_bind_vertex_array(m_vao);
     
-    // determine la taille du buffer pour stocker tous les attributs et les indices
-    size_t size= vertex_buffer_size() + texcoord_buffer_size() + normal_buffer_size() + color_buffer_size();
-    // allouer le buffer
-    glGenBuffers(1, &m_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STATIC_DRAW);
-    
-    // transferer les attributs et configurer le format de sommet (vao)
-    size_t offset= 0;
-    size= vertex_buffer_size();
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertex_buffer());
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (const void *) offset);
-    glEnableVertexAttribArray(0);
+    // attributs presents, entrelaces et encodes dans un seul buffer, cf vertex_format.h
+    m_buffer_format= vertex_format_used(m_format, 
+        m_texcoords.size() == m_positions.size() && use_texcoord,
+        m_normals.size() == m_positions.size() && use_normal,
+        m_colors.size() == m_positions.size() && use_color);
     
-    if(m_texcoords.size() == m_positions.size() && use_texcoord)
-    {
-        offset= offset + size;
-        size= texcoord_buffer_size();
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, texcoord_buffer());
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (const void *) offset);
-        glEnableVertexAttribArray(1);
-    }
-    
-    if(m_normals.size() == m_positions.size() && use_normal)
-    {
-        offset= offset + size;
-        size= normal_buffer_size();
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, normal_buffer());
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (const void *) offset);
-        glEnableVertexAttribArray(2);
-    }
+    std::vector<unsigned char> data;
+    vertex_encode(m_buffer_format, m_positions, m_texcoords, m_normals, m_colors, data, m_position_scale, m_position_offset);
     
-    if(m_colors.size() == m_positions.size() && use_color)
-    {
-        offset= offset + size;
-        size= color_buffer_size();
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, color_buffer());
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, (const void *) offset);
-        glEnableVertexAttribArray(3);
-    }
+    // allouer le buffer, transferer les attributs et configurer le format de sommet (vao)
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+    vertex_format_attributes(m_buffer_format);
     
     // allouer l'index buffer
     if(index_buffer_size())
     {
         glGenBuffers(1, &m_index_buffer);    
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_size(), index_buffer(), GL_STATIC_DRAW);
+        
+        // indices 16 bits, si possible : pas de strips, cf restart_strip( ) et l'indice ~0u
+        bool strips= (m_primitives != GL_TRIANGLES && m_primitives != GL_LINES && m_primitives != GL_POINTS);
+        if(!strips && m_positions.size() <= 65536)
+        {
+            std::vector<uint16_t> indices(m_indices.begin(), m_indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+            m_index_type= GL_UNSIGNED_SHORT;
+        }
+        else
+        {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_size(), index_buffer(), GL_STATIC_DRAW);
+            m_index_type= GL_UNSIGNED_INT;
+        }
     }
 
     m_update_buffers= false;
     
-    glBindVertexArray(0);
+    // le vao doit etre desactive avant de detacher l'index buffer
+    state_bind_vertex_array(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     return m_vao;
@@ -369,32 +597,12 @@ int Mesh::update_buffers( const bool use_texcoord, const bool use_normal, const
     if(!m_update_buffers)
         return 0;
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-    
-    size_t offset= 0;
-    size_t size= vertex_buffer_size();
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertex_buffer());
-    
-    if(m_texcoords.size() == m_positions.size() && use_texcoord)
-    {
-        offset= offset + size;
-        size= texcoord_buffer_size();
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, texcoord_buffer());
-    }
+    // encode de nouveau tous les sommets, dans le format des buffers
+    std::vector<unsigned char> data;
+    vertex_encode(m_buffer_format, m_positions, m_texcoords, m_normals, m_colors, data, m_position_scale, m_position_offset);
     
-    if(m_normals.size() == m_positions.size() && use_normal)
-    {
-        offset= offset + size;
-        size= normal_buffer_size();
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, normal_buffer());
-    }
-    
-    if(m_colors.size() == m_positions.size() && use_color)
-    {
-        offset= offset + size;
-        size= color_buffer_size();
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, color_buffer());
-    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, data.size(), data.data());
     
     m_update_buffers= false;
     return 1;
@@ -415,13 +623,15 @@ GLuint Mesh::create_program( const bool use_texcoord, const bool use_normal, con
         definitions.append("#define USE_LIGHT\n");
     if(use_texcoord && use_alpha_test)
         definitions.append("#define USE_ALPHATEST\n");
+    definitions.append(vertex_format_definitions(m_format));
 
     //~ printf("--\n%s", definitions.c_str());
     bool use_mesh_color= (m_primitives == GL_POINTS || m_primitives == GL_LINES || m_primitives == GL_LINE_STRIP || m_primitives == GL_LINE_LOOP);
+    // les meshs utilisent les memes shaders, ils ne sont compiles qu'une fois
     if(!use_mesh_color)
-        m_program= read_program( smart_path("data/mesh.glsl"), definitions.c_str());
+        m_program= read_shared_program( smart_path("data/mesh.glsl"), definitions.c_str());
     else
-        m_program= read_program( smart_path("data/mesh.glsl"), definitions.c_str());
+        m_program= read_shared_program( smart_path("data/mesh.glsl"), definitions.c_str());
     return m_program;
 }
 
@@ -450,8 +660,8 @@ void Mesh::draw( const Transform& model, const Transform& view, const Transform&
     if(m_program == 0)
     {
         // pas de shader pour ce type de draw
+        // compile en tache de fond, cf program_ready( )
         create_program(use_texcoord, use_normal, use_color, use_light, use_alpha_test);
-        program_print_errors(m_program);
 
         // conserver le shader
         m_state_map[key]= m_program;
@@ -461,29 +671,39 @@ void Mesh::draw( const Transform& model, const Transform& view, const Transform&
     assert(m_program != 0);
     m_state= key;
 
-    glUseProgram(m_program);
-    program_uniform(m_program, "mesh_color", default_color());
+    // pas de draw tant que le shader n'est pas compile, sans attendre le driver
+    if(!program_ready(m_program))
+        return;
 
-    Transform mv= view * model;
-    Transform mvp= projection * mv;
+    state_use_program(m_program);
+    // identifiants des uniforms resolus apres le link, cf program_uniform_slots( )
+    const GLint *slots= program_uniform_slots(m_program);
+    Color color= default_color();
+    glUniform4fv(slots[UNIFORM_MESH_COLOR], 1, &color.r);
 
-    program_uniform(m_program, "mvpMatrix", mvp);
-    program_uniform(m_program, "mvMatrix", mv);
+    // view et projection sont partagees par tous les draws, cf camera_uniforms( )
+    camera_uniforms(view, projection);
+    glUniformMatrix4fv(slots[UNIFORM_MODEL_MATRIX], 1, GL_TRUE, model.buffer());
     if(use_normal)
-        program_uniform(m_program, "normalMatrix", mv.normal()); // transforme les normales dans le repere camera.
+        glUniformMatrix4fv(slots[UNIFORM_NORMAL_MATRIX], 1, GL_TRUE, (view * model).normal().buffer()); // transforme les normales dans le repere camera.
 
     // utiliser une texture, elle ne sera visible que si le mesh a des texcoords...
-    if(texture && use_texcoord && use_texture)
-        program_use_texture(m_program, "diffuse_color", 0, texture);
+    if(texture && use_texcoord && use_texture && slots[UNIFORM_DIFFUSE_COLOR] >= 0)
+    {
+        state_bind_texture(0, texture);
+        state_bind_sampler(0, 0);
+        glUniform1i(slots[UNIFORM_DIFFUSE_COLOR], 0);
+    }
 
     if(use_light)
     {
-        program_uniform(m_program, "light", view(light));       // transforme la position de la source dans le repere camera, comme les normales
-        program_uniform(m_program, "light_color", light_color);
+        Point p= view(light);       // transforme la position de la source dans le repere camera, comme les normales
+        glUniform3fv(slots[UNIFORM_LIGHT], 1, &p.x);
+        glUniform4fv(slots[UNIFORM_LIGHT_COLOR], 1, &light_color.r);
     }
     
     if(use_alpha_test)
-        program_uniform(m_program, "alpha_min", alpha_min);
+        glUniform1f(slots[UNIFORM_ALPHA_MIN], alpha_min);
     
     draw(m_program);
 }
@@ -498,11 +718,19 @@ void Mesh::draw( const GLuint program )
     if(m_update_buffers)
         update_buffers(true, true, true);
     
-    glBindVertexArray(m_vao);
-    glUseProgram(program);
+    state_bind_vertex_array(m_vao);
+    state_use_program(program);
+    
+    if(m_buffer_format.position == VERTEX_SNORM16)
+    {
+        // positions quantifiees, cf vertex_encode( )
+        const GLint *slots= program_uniform_slots(program);
+        glUniform3fv(slots[UNIFORM_POSITION_SCALE], 1, &m_position_scale.x);
+        glUniform3fv(slots[UNIFORM_POSITION_OFFSET], 1, &m_position_offset.x);
+    }
     
     if(m_indices.size() > 0)
-        glDrawElements(m_primitives, (GLsizei) m_indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(m_primitives, (GLsizei) m_indices.size(), m_index_type, 0);
     else
         glDrawArrays(m_primitives, 0, (GLsizei) m_positions.size());
 }
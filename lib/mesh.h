@@ -10,6 +10,7 @@
 #include "vec.h"
 #include "mat.h"
 #include "color.h"
+#include "vertex_format.h"
 
 
 //! \addtogroup objet3D utilitaires pour manipuler des objets 3d
@@ -112,11 +113,13 @@ public:
     //@{
     //! constructeur par defaut.
     Mesh( ) : m_positions(), m_texcoords(), m_normals(), m_colors(), m_indices(), m_state_map(), m_state(0),
-        m_color(White()), m_primitives(GL_POINTS), m_vao(0), m_buffer(0), m_index_buffer(0), m_program(0), m_update_buffers(false) {}
+        m_color(White()), m_format(VERTEX_FORMAT_COMPACT), m_buffer_format(VERTEX_FORMAT_COMPACT), m_position_scale(1, 1, 1), m_position_offset(0, 0, 0), m_index_type(GL_UNSIGNED_INT),
+        m_primitives(GL_POINTS), m_vao(0), m_buffer(0), m_index_buffer(0), m_program(0), m_update_buffers(false) {}
     
     //! constructeur.
     Mesh( const GLenum primitives ) : m_positions(), m_texcoords(), m_normals(), m_colors(), m_indices(), m_state_map(), m_state(0),
-        m_color(White()), m_primitives(primitives), m_vao(0), m_buffer(0), m_index_buffer(0), m_program(0), m_update_buffers(false) {}
+        m_color(White()), m_format(VERTEX_FORMAT_COMPACT), m_buffer_format(VERTEX_FORMAT_COMPACT), m_position_scale(1, 1, 1), m_position_offset(0, 0, 0), m_index_type(GL_UNSIGNED_INT),
+        m_primitives(primitives), m_vao(0), m_buffer(0), m_index_buffer(0), m_program(0), m_update_buffers(false) {}
     
     //! construit les objets openGL.
     int create( const GLenum primitives );
@@ -152,6 +155,49 @@ public:
     //! insere un sommet de position p, et ses attributs (s'ils sont definis par color(), texcoord(), normal()), dans l'objet. renvoie l'indice du sommet.
     unsigned int vertex( const float x, const float y, const float z ) { return vertex(vec3(x, y, z)); }
     //@}
+    
+    /*! \name construction en bloc, sans copies intermediaires.
+        les tableaux d'attributs doivent avoir autant d'elements que les positions, ou etre vides.
+    \code
+    Mesh m(GL_TRIANGLES);
+    std::vector<vec3> positions= { ... };
+    m.adopt_positions(std::move(positions));    // pas de copie
+    m.constant_color(Red());                    // pas de couleur par sommet
+    \endcode
+     */
+    //@{
+    //! reserve la place pour vertices sommets (et leurs attributs deja definis) et indices indices.
+    Mesh& reserve( const unsigned int vertices, const unsigned int indices= 0 );
+    
+    //! remplace les positions des sommets, sans copie.
+    Mesh& adopt_positions( std::vector<vec3>&& positions );
+    //! remplace les coordonnees de texture des sommets, sans copie.
+    Mesh& adopt_texcoords( std::vector<vec2>&& texcoords );
+    //! remplace les normales des sommets, sans copie.
+    Mesh& adopt_normals( std::vector<vec3>&& normals );
+    //! remplace les couleurs des sommets, sans copie.
+    Mesh& adopt_colors( std::vector<vec4>&& colors );
+    //! remplace les indices des sommets, sans copie.
+    Mesh& adopt_indices( std::vector<unsigned int>&& indices );
+    //! remplace les indices des matieres des triangles, sans copie. cf materials( ).
+    Mesh& adopt_materials( std::vector<unsigned int>&& materials );
+    //! recupere la geometrie, les matieres et le type de primitives de mesh, sans copie. mesh est vide ensuite.
+    Mesh& adopt( Mesh&& mesh );
+    
+    //! ajoute n positions.
+    Mesh& append_positions( const vec3 *positions, const size_t n );
+    //! ajoute n coordonnees de texture.
+    Mesh& append_texcoords( const vec2 *texcoords, const size_t n );
+    //! ajoute n normales.
+    Mesh& append_normals( const vec3 *normals, const size_t n );
+    //! ajoute n couleurs.
+    Mesh& append_colors( const vec4 *colors, const size_t n );
+    //! ajoute n indices, decales de base, cf ajouter un mesh apres d'autres sommets.
+    Mesh& append_indices( const unsigned int *indices, const size_t n, const unsigned int base= 0 );
+    
+    //! meme couleur pour tous les sommets, sans la stocker par sommet : supprime les couleurs des sommets et modifie default_color( ).
+    Mesh& constant_color( const Color& color );
+    //@}
 
     //! \name description de triangles indexes.
     //@{
@@ -248,6 +294,25 @@ public:
     //! modifie la couleur par defaut, utilisee si les sommets n'ont pas de couleur associee.
     Mesh& default_color( const Color& color );
     
+    //! \name optimisation.
+    //@{
+    /*! soude les sommets identiques, reordonne les triangles pour le cache de sommets transformes et les sommets dans l'ordre de leur utilisation, cf mesh_optimize.h.
+        les triangles sont ensuite indexes. uniquement pour GL_TRIANGLES. les indices des sommets et des triangles changent.
+     */
+    Mesh& optimize( );
+    //@}
+    
+    //! \name format des sommets.
+    //@{
+    //! renvoie l'encodage des attributs dans le vertex buffer.
+    const VertexFormat& vertex_format( ) const { return m_format; }
+    /*! choisit l'encodage des attributs dans le vertex buffer, VERTEX_FORMAT_COMPACT par defaut, cf vertex_format.h. 
+        les buffers et les shaders sont reconstruits au prochain draw.
+        les shaders fournis par l'application, cf draw( program ), doivent definir les uniforms position_scale et position_offset avec VERTEX_FORMAT_QUANTIZED, cf data/mesh.glsl.
+     */
+    Mesh& vertex_format( const VertexFormat& format );
+    //@}
+    
     //! \name manipulation des buffers d'attributs.
     //@{
     //! renvoie le nombre de sommets.
@@ -344,6 +409,8 @@ protected:
     
     //! modifie les buffers openGL, si necessaire.
     int update_buffers( const bool use_texcoord, const bool use_normal, const bool use_color );
+    //! detruit les buffers openGL, ils seront reconstruits par le prochain draw.
+    void release_buffers( );
     
     //
     std::vector<vec3> m_positions;
@@ -361,6 +428,12 @@ protected:
 
     Color m_color;
     
+    VertexFormat m_format;
+    VertexFormat m_buffer_format;   //!< format des buffers, sans les attributs absents.
+    vec3 m_position_scale;          //!< quantification des positions, cf vertex_encode( ).
+    vec3 m_position_offset;
+    GLenum m_index_type;            //!< GL_UNSIGNED_SHORT quand c'est possible, ou GL_UNSIGNED_INT.
+    
     GLenum m_primitives;
     GLuint m_vao;
     GLuint m_buffer;
@@ -0,0 +1,262 @@
+
+//! \file mesh_optimize.cpp
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "mesh_optimize.h"
+
+
+// hash fnv-1a des attributs d'un sommet
+static uint64_t hash( const void *data, const size_t size, uint64_t h )
+{
+    const unsigned char *bytes= (const unsigned char *) data;
+    for(size_t i= 0; i < size; i++)
+    {
+        h^= bytes[i];
+        h*= 1099511628211ull;
+    }
+    return h;
+}
+
+namespace {
+struct Attributes
+{
+    const std::vector<vec3>& positions;
+    const std::vector<vec2>& texcoords;
+    const std::vector<vec3>& normals;
+    const std::vector<vec4>& colors;
+    
+    uint64_t hash( const unsigned int i ) const
+    {
+        uint64_t h= 14695981039346656037ull;
+        h= ::hash(&positions[i], sizeof(vec3), h);
+        if(!texcoords.empty()) h= ::hash(&texcoords[i], sizeof(vec2), h);
+        if(!normals.empty()) h= ::hash(&normals[i], sizeof(vec3), h);
+        if(!colors.empty()) h= ::hash(&colors[i], sizeof(vec4), h);
+        return h;
+    }
+    
+    bool equal( const unsigned int a, const unsigned int b ) const
+    {
+        return memcmp(&positions[a], &positions[b], sizeof(vec3)) == 0
+            && (texcoords.empty() || memcmp(&texcoords[a], &texcoords[b], sizeof(vec2)) == 0)
+            && (normals.empty() || memcmp(&normals[a], &normals[b], sizeof(vec3)) == 0)
+            && (colors.empty() || memcmp(&colors[a], &colors[b], sizeof(vec4)) == 0);
+    }
+};
+}
+
+unsigned int weld_vertices( const std::vector<vec3>& positions, const std::vector<vec2>& texcoords, const std::vector<vec3>& normals, const std::vector<vec4>& colors,
+    std::vector<unsigned int>& remap )
+{
+    assert(texcoords.empty() || texcoords.size() == positions.size());
+    assert(normals.empty() || normals.size() == positions.size());
+    assert(colors.empty() || colors.size() == positions.size());
+    
+    Attributes attributes= { positions, texcoords, normals, colors };
+    const unsigned int n= (unsigned int) positions.size();
+    
+    // table de hachage, adressage ouvert, au moins 2 fois plus grande que le nombre de sommets
+    size_t size= 1;
+    while(size < 2 * size_t(n))
+        size*= 2;
+    std::vector<unsigned int> table(size, ~0u);
+    
+    remap.assign(n, ~0u);
+    unsigned int count= 0;
+    for(unsigned int i= 0; i < n; i++)
+    {
+        size_t slot= attributes.hash(i) & (size -1);
+        for(;;)
+        {
+            unsigned int v= table[slot];
+            if(v == ~0u)
+            {
+                // nouveau sommet
+                table[slot]= i;
+                remap[i]= count++;
+                break;
+            }
+            if(attributes.equal(v, i))
+            {
+                remap[i]= remap[v];
+                break;
+            }
+            slot= (slot + 1) & (size -1);
+        }
+    }
+    
+    return count;
+}
+
+
+// score d'un sommet, cf "Linear-Speed Vertex Cache Optimisation", T. Forsyth, 2006
+static const int CACHE_SIZE= 32;
+
+static float vertex_score( const int cache_position, const int valence )
+{
+    if(valence == 0)
+        // plus de triangles a dessiner
+        return -1;
+    
+    float score= 0;
+    if(cache_position >= 0)
+    {
+        if(cache_position < 3)
+            // les sommets du dernier triangle : le suivant ne doit pas les reutiliser tous les 3
+            score= 0.75f;
+        else
+            score= std::pow(1 - float(cache_position - 3) / float(CACHE_SIZE - 3), 1.5f);
+    }
+    
+    // termine d'abord les sommets qui ont peu de triangles
+    score+= 2 * std::pow(float(valence), -0.5f);
+    return score;
+}
+
+void optimize_vertex_cache( const std::vector<unsigned int>& indices, const unsigned int vertex_count, std::vector<unsigned int>& order )
+{
+    const unsigned int triangle_count= (unsigned int) indices.size() / 3;
+    order.clear();
+    order.reserve(triangle_count);
+    if(triangle_count == 0)
+        return;
+    
+    // triangles de chaque sommet
+    std::vector<unsigned int> offsets(vertex_count + 1, 0);
+    for(unsigned int i= 0; i < triangle_count * 3; i++)
+        offsets[indices[i] + 1]++;
+    for(unsigned int i= 0; i < vertex_count; i++)
+        offsets[i + 1]+= offsets[i];
+    
+    std::vector<unsigned int> adjacency(triangle_count * 3);
+    std::vector<int> valence(vertex_count, 0);      // triangles pas encore dessines
+    for(unsigned int i= 0; i < triangle_count * 3; i++)
+    {
+        unsigned int v= indices[i];
+        adjacency[offsets[v] + valence[v]]= i / 3;
+        valence[v]++;
+    }
+    
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> score(vertex_count);
+    for(unsigned int v= 0; v < vertex_count; v++)
+        score[v]= vertex_score(-1, valence[v]);
+    
+    std::vector<bool> emitted(triangle_count, false);
+    
+    // cache lru, + 3 sommets pour le triangle ajoute
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> next_cache;
+    cache.reserve(CACHE_SIZE + 3);
+    next_cache.reserve(CACHE_SIZE + 3);
+    
+    unsigned int best= 0;
+    unsigned int cursor= 0;     // premier triangle peut etre pas encore dessine
+    while(order.size() < triangle_count)
+    {
+        if(best == ~0u)
+        {
+            // plus de candidats dans le cache : le prochain triangle pas encore dessine
+            while(emitted[cursor])
+                cursor++;
+            best= cursor;
+        }
+        
+        order.push_back(best);
+        emitted[best]= true;
+        
+        // retire le triangle des sommets et les place en tete du cache
+        next_cache.clear();
+        for(int k= 0; k < 3; k++)
+        {
+            unsigned int v= indices[3*best + k];
+            unsigned int *begin= adjacency.data() + offsets[v];
+            unsigned int *end= begin + valence[v];
+            std::remove(begin, end, best);
+            valence[v]--;
+            
+            if(std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end())
+                next_cache.push_back(v);
+        }
+        for(unsigned int i= 0; i < cache.size(); i++)
+            if(std::find(next_cache.begin(), next_cache.end(), cache[i]) == next_cache.end())
+                next_cache.push_back(cache[i]);
+        
+        // les sommets sortis du cache
+        for(unsigned int i= CACHE_SIZE; i < next_cache.size(); i++)
+        {
+            cache_position[next_cache[i]]= -1;
+            score[next_cache[i]]= vertex_score(-1, valence[next_cache[i]]);
+        }
+        if(next_cache.size() > (size_t) CACHE_SIZE)
+            next_cache.resize(CACHE_SIZE);
+        std::swap(cache, next_cache);
+        
+        // nouveaux scores des sommets du cache et de leurs triangles, choisit le meilleur
+        for(unsigned int i= 0; i < cache.size(); i++)
+        {
+            unsigned int v= cache[i];
+            cache_position[v]= int(i);
+            score[v]= vertex_score(int(i), valence[v]);
+        }
+        
+        best= ~0u;
+        float best_score= -1;
+        for(unsigned int i= 0; i < cache.size(); i++)
+        {
+            unsigned int v= cache[i];
+            for(int k= 0; k < valence[v]; k++)
+            {
+                unsigned int t= adjacency[offsets[v] + k];
+                float s= score[indices[3*t]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+                if(s > best_score)
+                {
+                    best_score= s;
+                    best= t;
+                }
+            }
+        }
+    }
+}
+
+unsigned int optimize_vertex_fetch( std::vector<unsigned int>& indices, const unsigned int vertex_count, std::vector<unsigned int>& remap )
+{
+    remap.assign(vertex_count, ~0u);
+    unsigned int count= 0;
+    for(unsigned int i= 0; i < (unsigned int) indices.size(); i++)
+    {
+        unsigned int v= indices[i];
+        if(remap[v] == ~0u)
+            remap[v]= count++;
+        indices[i]= remap[v];
+    }
+    
+    return count;
+}
+
+float vertex_cache_acmr( const std::vector<unsigned int>& indices, const unsigned int vertex_count, const int cache_size )
+{
+    if(indices.size() < 3)
+        return 0;
+    
+    // cache fifo : date d'entree de chaque sommet
+    std::vector<unsigned int> timestamps(vertex_count, 0);
+    unsigned int time= cache_size + 1;
+    unsigned int misses= 0;
+    for(unsigned int i= 0; i < (unsigned int) indices.size(); i++)
+    {
+        unsigned int v= indices[i];
+        if(time - timestamps[v] > (unsigned int) cache_size)
+        {
+            timestamps[v]= time++;
+            misses++;
+        }
+    }
+    
+    return float(misses) / float(indices.size() / 3);
+}
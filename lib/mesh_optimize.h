@@ -0,0 +1,34 @@
+
+#ifndef _MESH_OPTIMIZE_H
+#define _MESH_OPTIMIZE_H
+
+#include <vector>
+
+#include "vec.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+/*! \file
+optimisation des triangles indexes, cf Mesh::optimize( ) :
+    - soude les sommets identiques,
+    - reordonne les triangles pour reutiliser les sommets deja transformes, par le cache du gpu (algorithme de T. Forsyth),
+    - renumerote les sommets dans l'ordre de leur premiere utilisation, pour lire la memoire dans l'ordre.
+ */
+
+//! soude les sommets dont tous les attributs sont identiques. les tableaux vides sont ignores. renvoie le nombre de sommets uniques, remap[i] est le nouvel indice du sommet i.
+unsigned int weld_vertices( const std::vector<vec3>& positions, const std::vector<vec2>& texcoords, const std::vector<vec3>& normals, const std::vector<vec4>& colors,
+    std::vector<unsigned int>& remap );
+
+//! reordonne les triangles pour le cache de sommets transformes. order[i] est l'indice du i-ieme triangle a dessiner.
+void optimize_vertex_cache( const std::vector<unsigned int>& indices, const unsigned int vertex_count, std::vector<unsigned int>& order );
+
+//! renumerote les sommets dans l'ordre de leur premiere utilisation et modifie indices. renvoie le nombre de sommets utilises, remap[i] est le nouvel indice du sommet i, ou ~0u s'il n'est pas utilise.
+unsigned int optimize_vertex_fetch( std::vector<unsigned int>& indices, const unsigned int vertex_count, std::vector<unsigned int>& remap );
+
+//! renvoie le nombre moyen de sommets transformes par triangle (acmr), avec un cache fifo de cache_size sommets. entre 0.5 (ideal) et 3 (pas de reutilisation).
+float vertex_cache_acmr( const std::vector<unsigned int>& indices, const unsigned int vertex_count, const int cache_size= 16 );
+
+///@}
+#endif
@@ -0,0 +1,190 @@
+
+//! \file profiler.cpp
+
+#include <cstdio>
+#include <cstring>
+
+#include "profiler.h"
+
+
+// moyenne glissante, sur une trentaine d'images
+static float smooth( const float average, const float value )
+{
+    return average == 0 ? value : average * 0.97f + value * 0.03f;
+}
+
+static float milliseconds( const std::chrono::high_resolution_clock::duration d )
+{
+    return std::chrono::duration<float, std::milli>(d).count();
+}
+
+
+int Profiler::create( )
+{
+    for(int i= 0; i < PROFILER_FRAMES; i++)
+    {
+        m_frames[i].queries.resize(2);
+        glGenQueries(2, m_frames[i].queries.data());
+        m_frames[i].pending= false;
+    }
+
+    m_created= true;
+    return 0;
+}
+
+void Profiler::release( )
+{
+    if(!m_created)
+        return;
+
+    for(int i= 0; i < PROFILER_FRAMES; i++)
+    {
+        glDeleteQueries(GLsizei(m_frames[i].queries.size()), m_frames[i].queries.data());
+        m_frames[i].queries.clear();
+        m_frames[i].scopes.clear();
+    }
+
+    m_stats.clear();
+    m_created= false;
+}
+
+int Profiler::stat( const char *name, const int depth )
+{
+    for(unsigned int i= 0; i < m_stats.size(); i++)
+        if(m_stats[i].depth == depth && m_stats[i].name == name)
+            return int(i);
+
+    Stat s= { name, depth, 0.f, 0.f };
+    m_stats.push_back(s);
+    return int(m_stats.size()) -1;
+}
+
+GLuint Profiler::query( Frame& frame, const int index )
+{
+    // cree les requetes au besoin, une image peut avoir plus d'etapes que la precedente
+    while(int(frame.queries.size()) <= index)
+    {
+        GLuint q= 0;
+        glGenQueries(1, &q);
+        frame.queries.push_back(q);
+    }
+
+    return frame.queries[index];
+}
+
+void Profiler::read( Frame& frame )
+{
+    // la derniere requete de l'image est disponible : toutes les autres le sont aussi
+    GLint available= 0;
+    glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available)
+        // le gpu a plus de PROFILER_FRAMES images de retard, ne pas l'attendre, abandonner ces mesures
+        return;
+
+    GLuint64 start= 0;
+    GLuint64 stop= 0;
+    glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(frame.queries[1], GL_QUERY_RESULT, &stop);
+    m_gpu_frame= smooth(m_gpu_frame, float(stop - start) / 1000000.f);
+    m_cpu_frame= smooth(m_cpu_frame, milliseconds(frame.cpu_stop - frame.cpu_start));
+
+    for(unsigned int i= 0; i < frame.scopes.size(); i++)
+    {
+        const Scope& scope= frame.scopes[i];
+        glGetQueryObjectui64v(frame.queries[scope.query], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(frame.queries[scope.query +1], GL_QUERY_RESULT, &stop);
+
+        Stat& s= m_stats[scope.stat];
+        s.gpu= smooth(s.gpu, float(stop - start) / 1000000.f);
+        s.cpu= smooth(s.cpu, milliseconds(scope.cpu_stop - scope.cpu_start));
+    }
+}
+
+void Profiler::frame_begin( )
+{
+    if(!m_created)
+        return;
+
+    // recycle les requetes de l'image PROFILER_FRAMES images plus tot
+    Frame& frame= m_frames[m_frame % PROFILER_FRAMES];
+    if(frame.pending)
+        read(frame);
+
+    frame.scopes.clear();
+    frame.pending= false;
+    m_stack.clear();
+
+    frame.cpu_start= clock::now();
+    glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+}
+
+void Profiler::frame_end( )
+{
+    if(!m_created)
+        return;
+
+    // termine les etapes oubliees
+    while(!m_stack.empty())
+        end();
+
+    Frame& frame= m_frames[m_frame % PROFILER_FRAMES];
+    glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+    frame.cpu_stop= clock::now();
+    frame.pending= true;
+
+    m_frame++;
+}
+
+void Profiler::begin( const char *name )
+{
+    if(!m_created)
+        return;
+
+    Frame& frame= m_frames[m_frame % PROFILER_FRAMES];
+
+    Scope scope;
+    scope.stat= stat(name, int(m_stack.size()));
+    scope.query= 2 + 2 * int(frame.scopes.size());
+    glQueryCounter(query(frame, scope.query), GL_TIMESTAMP);
+    query(frame, scope.query +1);
+    scope.cpu_start= clock::now();
+
+    m_stack.push_back(int(frame.scopes.size()));
+    frame.scopes.push_back(scope);
+}
+
+void Profiler::end( )
+{
+    if(!m_created || m_stack.empty())
+        return;
+
+    Frame& frame= m_frames[m_frame % PROFILER_FRAMES];
+    Scope& scope= frame.scopes[m_stack.back()];
+    m_stack.pop_back();
+
+    scope.cpu_stop= clock::now();
+    glQueryCounter(frame.queries[scope.query +1], GL_TIMESTAMP);
+}
+
+
+void print( Text& text, const Profiler& profiler, const int x, const int y )
+{
+    printf(text, x, y, "frame %*s cpu %6.2fms  gpu %6.2fms", 12, "", profiler.frame_cpu(), profiler.frame_gpu());
+    for(int i= 0; i < profiler.scopes(); i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%*s%s", 2 + 2 * profiler.depth(i), "", profiler.name(i));
+        printf(text, x, y + 1 + i, "%-18s cpu %6.2fms  gpu %6.2fms", name, profiler.cpu(i), profiler.gpu(i));
+    }
+}
+
+void print( FILE *out, const Profiler& profiler )
+{
+    fprintf(out, "frame %*s cpu %6.2fms  gpu %6.2fms\n", 12, "", profiler.frame_cpu(), profiler.frame_gpu());
+    for(int i= 0; i < profiler.scopes(); i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%*s%s", 2 + 2 * profiler.depth(i), "", profiler.name(i));
+        fprintf(out, "%-18s cpu %6.2fms  gpu %6.2fms\n", name, profiler.cpu(i), profiler.gpu(i));
+    }
+}
@@ -0,0 +1,134 @@
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "glcore.h"
+#include "text.h"
+
+
+//! \addtogroup application
+///@{
+
+//! \file
+//! mesure du temps cpu et gpu de chaque etape d'une image, sans attendre le gpu.
+
+//! nombre d'images en vol : les requetes d'une image sont relues PROFILER_FRAMES images plus tard.
+static const int PROFILER_FRAMES= 4;
+
+/*! profiler cpu / gpu : etapes nommees (imbricables), temps gpu mesures par des requetes GL_TIMESTAMP.
+les resultats d'une image sont relus quand le gpu les a produits, quelques images plus tard, sans bloquer l'application.
+les temps affiches sont des moyennes glissantes.
+
+exemple :
+\code
+Profiler profiler;
+profiler.create();
+
+// pour chaque image
+profiler.frame_begin();
+{
+    ProfilerScope scope(profiler, "terrain");
+    draw(...);
+}
+profiler.frame_end();
+print(console, profiler, 0, 20);
+\endcode
+*/
+class Profiler
+{
+public:
+    Profiler( ) : m_frame(0), m_cpu_frame(0), m_gpu_frame(0), m_created(false) {}
+
+    //! cree les requetes openGL. necessite un contexte openGL.
+    int create( );
+    //! detruit les requetes openGL.
+    void release( );
+
+    //! debut d'une image, relit les mesures disponibles des images precedentes.
+    void frame_begin( );
+    //! fin d'une image.
+    void frame_end( );
+
+    //! debut d'une etape.
+    void begin( const char *name );
+    //! fin de la derniere etape commencee.
+    void end( );
+
+    //! nombre d'etapes deja mesurees.
+    int scopes( ) const { return int(m_stats.size()); }
+    //! nom de l'etape index.
+    const char *name( const int index ) const { return m_stats[index].name.c_str(); }
+    //! profondeur de l'etape index, 0 pour une etape qui n'est pas imbriquee.
+    int depth( const int index ) const { return m_stats[index].depth; }
+    //! temps cpu moyen de l'etape index, en millisecondes.
+    float cpu( const int index ) const { return m_stats[index].cpu; }
+    //! temps gpu moyen de l'etape index, en millisecondes.
+    float gpu( const int index ) const { return m_stats[index].gpu; }
+
+    //! temps cpu moyen d'une image, en millisecondes.
+    float frame_cpu( ) const { return m_cpu_frame; }
+    //! temps gpu moyen d'une image, en millisecondes.
+    float frame_gpu( ) const { return m_gpu_frame; }
+
+protected:
+    typedef std::chrono::high_resolution_clock clock;
+
+    struct Scope
+    {
+        int stat;                       //!< indice dans m_stats.
+        clock::time_point cpu_start;
+        clock::time_point cpu_stop;
+        int query;                      //!< requetes query et query+1 de l'image.
+    };
+
+    struct Frame
+    {
+        std::vector<GLuint> queries;    //!< 0 et 1 : debut et fin de l'image, puis 2 par etape.
+        std::vector<Scope> scopes;
+        clock::time_point cpu_start;
+        clock::time_point cpu_stop;
+        bool pending;                   //!< mesures pas encore relues.
+    };
+
+    struct Stat
+    {
+        std::string name;
+        int depth;
+        float cpu;
+        float gpu;
+    };
+
+    int stat( const char *name, const int depth );
+    GLuint query( Frame& frame, const int index );
+    void read( Frame& frame );
+
+    Frame m_frames[PROFILER_FRAMES];
+    std::vector<Stat> m_stats;
+    std::vector<int> m_stack;           //!< etapes en cours dans l'image courante.
+    unsigned int m_frame;
+    float m_cpu_frame;
+    float m_gpu_frame;
+    bool m_created;
+};
+
+//! mesure une etape jusqu'a la fin du bloc.
+struct ProfilerScope
+{
+    ProfilerScope( Profiler& profiler, const char *name ) : m_profiler(profiler) { m_profiler.begin(name); }
+    ~ProfilerScope( ) { m_profiler.end(); }
+
+    Profiler& m_profiler;
+};
+
+//! affiche les temps de chaque etape a la position x, y de la console, 1 ligne par etape, plus une ligne pour l'image.
+void print( Text& text, const Profiler& profiler, const int x, const int y );
+//! ecrit les memes lignes dans un fichier, ou le terminal (stdout), sans console.
+void print( FILE *out, const Profiler& profiler );
+
+///@}
+#endif
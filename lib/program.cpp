@@ -4,10 +4,26 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
+#include <chrono>
 
 #include <climits>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+
+#include <ctime>
+#include <sys/stat.h>
+#ifdef WIN32
+#include <direct.h>
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 #include "program.h"
+#include "state.h"
 
 
 // charge un fichier texte.
@@ -128,7 +144,7 @@ GLenum shader_types[] =
 };
 
 static
-GLuint compile_shader( const GLuint program, const GLenum shader_type, const std::string& source )
+GLuint compile_shader( const GLuint program, const GLenum shader_type, const std::string& source, const bool wait )
 {
     if(source.size() == 0 || shader_type == 0)
         return 0;
@@ -139,6 +155,9 @@ GLuint compile_shader( const GLuint program, const GLenum shader_type, const std
     const char *sources= source.c_str();
     glShaderSource(shader, 1, &sources, NULL);
     glCompileShader(shader);
+    if(!wait)
+        // les erreurs seront verifiees apres le link
+        return shader;
 
     GLint status;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
@@ -146,12 +165,300 @@ GLuint compile_shader( const GLuint program, const GLenum shader_type, const std
 }
 
 
-int reload_program( GLuint program, const char *filename, const char *definitions )
+// uniforms actifs de chaque program, recuperes apres le link
+struct UniformLocation
 {
-    if(program == 0)
+    std::string name;
+    GLint location;
+};
+
+struct UniformTable
+{
+    std::vector<UniformLocation> uniforms;
+    std::vector<GLint> slots;       // identifiants des uniforms enregistres, cf uniform_slot( )
+};
+
+static std::unordered_map<GLuint, UniformTable> uniform_tables;
+
+// noms des uniforms enregistres, dans l'ordre de UniformSlot, puis ceux de uniform_slot( )
+static
+std::vector<std::string>& uniform_slot_names( )
+{
+    static std::vector<std::string> names= {
+        "modelMatrix", "normalMatrix", "mesh_color", "diffuse_color",
+        "light", "light_color", "alpha_min", "position_scale", "position_offset" };
+    return names;
+}
+
+static
+GLint find_location( const std::vector<UniformLocation>& table, const char *uniform )
+{
+    for(unsigned int i= 0; i < table.size(); i++)
+        if(strcmp(table[i].name.c_str(), uniform) == 0)
+            return table[i].location;
+
+    return -1;
+}
+
+static
+void reflect_uniforms( const GLuint program )
+{
+    std::vector<UniformLocation>& table= uniform_tables[program].uniforms;
+    table.clear();
+
+    GLint uniforms= 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniforms);
+    GLint length= 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &length);
+
+    std::vector<char> name(length +1, 0);
+    for(int i= 0; i < uniforms; i++)
+    {
+        GLint size= 0;
+        GLenum type= 0;
+        glGetActiveUniform(program, i, (GLsizei) name.size(), NULL, &size, &type, &name.front());
+
+        // les uniforms des blocks n'ont pas d'identifiant
+        GLint location= glGetUniformLocation(program, &name.front());
+        if(location < 0)
+            continue;
+
+        UniformLocation u= { &name.front(), location };
+        table.push_back(u);
+
+        // un tableau est aussi accessible par son nom, sans [0]
+        size_t array= u.name.find("[0]");
+        if(array != std::string::npos)
+        {
+            u.name.erase(array);
+            table.push_back(u);
+        }
+    }
+
+    // resout les uniforms enregistres une seule fois, les draws n'ont plus qu'a indexer la table
+    const std::vector<std::string>& names= uniform_slot_names();
+    std::vector<GLint>& slots= uniform_tables[program].slots;
+    slots.resize(names.size());
+    for(unsigned int i= 0; i < names.size(); i++)
+        slots[i]= find_location(table, names[i].c_str());
+
+    // les matrices de la camera sont partagees par tous les shaders
+    GLuint block= glGetUniformBlockIndex(program, "camera");
+    if(block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, block, CAMERA_BINDING);
+}
+
+GLint program_uniform_location( const GLuint program, const char *uniform )
+{
+    auto found= uniform_tables.find(program);
+    if(found == uniform_tables.end())
         return -1;
 
-    // supprime les shaders attaches au program
+    return find_location(found->second.uniforms, uniform);
+}
+
+int uniform_slot( const char *uniform )
+{
+    std::vector<std::string>& names= uniform_slot_names();
+    for(unsigned int i= 0; i < names.size(); i++)
+        if(names[i] == uniform)
+            return int(i);
+
+    // resout le nouvel uniform dans les programs deja linkes
+    names.push_back(uniform);
+    for(auto& table : uniform_tables)
+        table.second.slots.push_back(find_location(table.second.uniforms, uniform));
+
+    return int(names.size()) -1;
+}
+
+const GLint *program_uniform_slots( const GLuint program )
+{
+    auto found= uniform_tables.find(program);
+    if(found != uniform_tables.end())
+        return found->second.slots.data();
+
+    // program pas encore linke : aucun uniform
+    static std::vector<GLint> none;
+    none.assign(uniform_slot_names().size(), -1);
+    return none.data();
+}
+
+
+// cache des binaires des programs sur disque
+
+static const char *program_cache_directory= "program_cache";
+
+struct ProgramBinaryHeader
+{
+    char magic[8];
+    GLenum format;
+    GLint length;
+};
+
+static
+bool program_binary_supported( )
+{
+    GLint formats= 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// fnv-1a 64 bits
+static
+uint64_t hash( uint64_t h, const char *data, const size_t length )
+{
+    for(size_t i= 0; i < length; i++)
+    {
+        h= h ^ (unsigned char) data[i];
+        h= h * 1099511628211ull;
+    }
+    return h;
+}
+
+// nom du fichier binaire : depend du source, des definitions et du driver
+static
+std::string program_binary_filename( const std::string& source, const char *definitions )
+{
+    uint64_t h= 14695981039346656037ull;
+    h= hash(h, source.data(), source.size());
+    h= hash(h, definitions, strlen(definitions) +1);
+
+    const GLenum strings[]= { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for(int i= 0; i < 3; i++)
+    {
+        const char *string= (const char *) glGetString(strings[i]);
+        if(string)
+            h= hash(h, string, strlen(string) +1);
+    }
+
+    char tmp[64];
+    sprintf(tmp, "/%016llx.bin", (unsigned long long) h);
+    return std::string(program_cache_directory).append(tmp);
+}
+
+static
+bool load_program_binary( const GLuint program, const std::string& filename )
+{
+    FILE *in= fopen(filename.c_str(), "rb");
+    if(in == NULL)
+        return false;
+
+    // taille du fichier, pour verifier l'entete d'un fichier tronque ou corrompu
+    struct stat info;
+    size_t size= (fstat(fileno(in), &info) == 0) ? (size_t) info.st_size : 0;
+
+    ProgramBinaryHeader header;
+    std::vector<char> binary;
+    bool valid= (fread(&header, sizeof(header), 1, in) == 1 && memcmp(header.magic, "gkitbin", sizeof(header.magic)) == 0
+        && header.length > 0 && sizeof(header) + (size_t) header.length <= size);
+    if(valid)
+    {
+        binary.resize(header.length);
+        valid= (fread(&binary.front(), 1, binary.size(), in) == binary.size());
+    }
+    fclose(in);
+    if(!valid)
+        return false;
+
+    // le driver peut refuser un binaire produit par une autre version
+    glProgramBinary(program, header.format, &binary.front(), (GLsizei) binary.size());
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return (status == GL_TRUE);
+}
+
+static
+void store_program_binary( const GLuint program, const std::string& filename )
+{
+    GLint length= 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+        return;
+
+    ProgramBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, "gkitbin");
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, NULL, &header.format, &binary.front());
+    header.length= length;
+
+#ifdef WIN32
+    _mkdir(program_cache_directory);
+#else
+    mkdir(program_cache_directory, 0755);
+#endif
+
+    FILE *out= fopen(filename.c_str(), "wb");
+    if(out == NULL)
+        return;
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(&binary.front(), 1, binary.size(), out);
+    fclose(out);
+}
+
+
+// compilation en cours, cf read_program_async( )
+struct ProgramBuild
+{
+    std::string filename;
+    std::string definitions;
+    std::string binary_filename;        //!< vide si les binaires ne sont pas disponibles.
+    int polls;                          //!< nombre d'appels a program_ready( ) depuis le link.
+};
+
+static std::unordered_map<GLuint, ProgramBuild> program_builds;
+
+// programs recharges quand leur source change, cf update_programs( )
+struct WatchedProgram
+{
+    std::string filename;
+    std::string definitions;
+    time_t time;                        //!< date de modification du source compile.
+    GLuint pending;                     //!< nouvelle version en cours de compilation, 0 sinon.
+};
+
+static std::unordered_map<GLuint, WatchedProgram> watched_programs;
+
+static
+time_t modification_time( const char *filename )
+{
+    struct stat info;
+    if(stat(filename, &info) < 0)
+        return 0;
+    return info.st_mtime;
+}
+
+static
+bool parallel_compile_supported( )
+{
+    static int supported= -1;
+    if(supported < 0)
+    {
+        supported= 0;
+        GLint extensions= 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+        for(int i= 0; i < extensions; i++)
+        {
+            const char *name= (const char *) glGetStringi(GL_EXTENSIONS, i);
+            if(name && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+                supported= 1;
+        }
+
+    #ifdef GL_KHR_parallel_shader_compile
+        // laisse le driver choisir le nombre de threads de compilation
+        if(supported && glMaxShaderCompilerThreadsKHR)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    #endif
+    }
+
+    return (supported == 1);
+}
+
+// detache et detruit les shaders du program
+static
+void release_shaders( const GLuint program )
+{
     int shaders_max= 0;
     glGetProgramiv(program, GL_ATTACHED_SHADERS, &shaders_max);
     if(shaders_max > 0)
@@ -164,6 +471,20 @@ int reload_program( GLuint program, const char *filename, const char *definition
             glDeleteShader(shaders[i]);
         }
     }
+}
+
+// compile et linke le program, sans attendre le resultat si wait est faux.
+// renvoie 1 si le program est deja pret (binaire), 0 si le link est lance, -1 en cas d'erreur.
+static
+int start_program( const GLuint program, const char *filename, const char *definitions, const bool wait, ProgramBuild& build )
+{
+    build.filename= filename;
+    build.definitions= definitions;
+    build.binary_filename.clear();
+    build.polls= 0;
+
+    // supprime les shaders attaches au program
+    release_shaders(program);
 
 #ifdef GL_VERSION_4_3
     glObjectLabel(GL_PROGRAM, program, -1, filename);
@@ -171,32 +492,118 @@ int reload_program( GLuint program, const char *filename, const char *definition
 
     // prepare les sources
     std::string common_source= read(filename);
+    if(common_source.empty())
+        return -1;
+
+    // recharge le binaire du program compile lors d'une execution precedente, si le source, les definitions et le driver n'ont pas change
+    if(program_binary_supported())
+    {
+        build.binary_filename= program_binary_filename(common_source, definitions);
+        if(load_program_binary(program, build.binary_filename))
+        {
+            reflect_uniforms(program);
+            return 1;
+        }
+
+        // autorise la recuperation du binaire apres le link
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
     for(int i = 0; i < shader_keys_max; i++)
     {
         if(common_source.find(shader_keys[i]) != std::string::npos)
         {
             // cree et compile les shaders detectes dans le source
             std::string source= prepare_source(common_source, std::string(definitions).append("#define ").append(shader_keys[i]).append("\n"));
-            GLuint shader= compile_shader(program, shader_types[i], source);
+            GLuint shader= compile_shader(program, shader_types[i], source, wait);
             if(shader == 0)
                 printf("[error] compiling %s...\n%s\n", shader_string(shader_types[i]), definitions);
         }
     }
-    
+
     // linke les shaders
     glLinkProgram(program);
+    return 0;
+}
 
+// verifie le resultat du link, recupere les uniforms et conserve le binaire.
+static
+int finish_program( const GLuint program, const ProgramBuild& build )
+{
     // verifie les erreurs
     GLint status;
     glGetProgramiv(program, GL_LINK_STATUS, &status);
     if(status == GL_FALSE)
     {
-        printf("[error] linking program %u '%s'...\n", program, filename);
+        printf("[error] linking program %u '%s'...\n", program, build.filename.c_str());
+        uniform_tables.erase(program);
         return -1;
     }
 
+    reflect_uniforms(program);
+    if(!build.binary_filename.empty())
+        store_program_binary(program, build.binary_filename);
+    return 0;
+}
+
+static
+void watch_program( const GLuint program, const char *filename, const char *definitions )
+{
+    WatchedProgram& watched= watched_programs[program];
+    watched.filename= filename;
+    watched.definitions= definitions;
+    watched.time= modification_time(filename);
+}
+
+// la nouvelle version, linkee sans erreur, remplace le program : l'identifiant du program selectionne le nouvel objet openGL, 
+// cf state_redirect_program( ). l'objet d'origine n'est pas detruit, il reserve l'identifiant du program.
+static
+void swap_program( const GLuint program, const GLuint update )
+{
+    GLuint previous= state_program_object(program);
+    state_redirect_program(program, update);
+    
+    UniformTable table= std::move(uniform_tables[update]);
+    uniform_tables.erase(update);
+    uniform_tables[program]= std::move(table);
+    
+    release_shaders(previous);
+    if(previous != program)
+        glDeleteProgram(previous);
+}
+
+// detruit la version rechargee du program, l'objet d'origine est de nouveau utilise
+static
+void release_update( const GLuint program )
+{
+    GLuint object= state_program_object(program);
+    if(object == program)
+        return;
+    
+    release_shaders(object);
+    glDeleteProgram(object);
+    state_redirect_program(program, program);
+}
+
+int reload_program( GLuint program, const char *filename, const char *definitions )
+{
+    if(program == 0)
+        return -1;
+
+    // recompile l'objet d'origine, la version rechargee n'est plus utilisee
+    release_update(program);
+
+    ProgramBuild build;
+    int code= start_program(program, filename, definitions, true, build);
+    if(code == 0)
+        code= finish_program(program, build);
+    else if(code < 0)
+        uniform_tables.erase(program);
+    if(code < 0)
+        return -1;
+
     // pour etre coherent avec les autres fonctions de creation, active l'objet gl qui vient d'etre cree.
-    glUseProgram(program);
+    state_use_program(program);
     return 0;
 }
 
@@ -204,29 +611,184 @@ GLuint read_program( const char *filename, const char *definitions )
 {
     GLuint program= glCreateProgram();
     reload_program(program, filename, definitions);
+    watch_program(program, filename, definitions);
     return program;
 }
 
+static
+GLuint create_program_async( const char *filename, const char *definitions )
+{
+    GLuint program= glCreateProgram();
+
+    ProgramBuild build;
+    int code= start_program(program, filename, definitions, false, build);
+    if(code == 0)
+        // le link est en cours, cf program_ready( )
+        program_builds[program]= build;
+    else if(code < 0)
+        uniform_tables.erase(program);
+    return program;
+}
+
+GLuint read_program_async( const char *filename, const char *definitions )
+{
+    GLuint program= create_program_async(filename, definitions);
+    watch_program(program, filename, definitions);
+    return program;
+}
+
+bool program_ready( const GLuint program )
+{
+    if(program == 0)
+        return false;
+
+    auto found= program_builds.find(program);
+    if(found == program_builds.end())
+        // la table des uniforms n'existe que pour les programs linkes correctement
+        return (uniform_tables.count(program) > 0);
+
+    ProgramBuild& build= found->second;
+    build.polls++;
+    if(parallel_compile_supported())
+    {
+        // demande au driver sans bloquer
+        GLint completed= 0;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+        if(completed == GL_FALSE)
+            return false;
+    }
+    else if(build.polls < 2)
+        // sans l'extension, le driver ne peut pas repondre sans bloquer : laisse une image au driver avant de verifier le link,
+        // glGetProgramiv( GL_LINK_STATUS ) attend la fin de la compilation si elle n'est pas terminee.
+        return false;
+
+    int code= finish_program(program, build);
+    if(code < 0)
+        program_print_errors(program);
+
+    program_builds.erase(found);
+    return (code == 0);
+}
+
+int update_programs( )
+{
+    // verifie les fichiers 2 fois par seconde
+    static std::chrono::steady_clock::time_point last;
+    std::chrono::steady_clock::time_point now= std::chrono::steady_clock::now();
+    bool check= (now - last > std::chrono::milliseconds(500));
+    if(check)
+        last= now;
+
+    int reloaded= 0;
+    for(auto it= watched_programs.begin(); it != watched_programs.end(); ++it)
+    {
+        GLuint program= it->first;
+        WatchedProgram& watched= it->second;
+
+        if(watched.pending)
+        {
+            if(program_ready(watched.pending))
+            {
+                // la nouvelle version est linkee, elle remplace le program
+                swap_program(program, watched.pending);
+                printf("reloaded program %u '%s'\n", program, watched.filename.c_str());
+                reloaded++;
+            }
+            else if(program_builds.count(watched.pending) > 0)
+                // compilation en cours
+                continue;
+            else
+            {
+                printf("[error] reloading program '%s', keeping the previous version...\n", watched.filename.c_str());
+                release_program(watched.pending);
+            }
+
+            watched.pending= 0;
+            continue;
+        }
+
+        if(!check)
+            continue;
+
+        time_t time= modification_time(watched.filename.c_str());
+        if(time == 0 || time == watched.time)
+            continue;
+
+        // recompile en tache de fond, le program actuel reste utilise jusqu'a la fin du link
+        watched.time= time;
+        watched.pending= create_program_async(watched.filename.c_str(), watched.definitions.c_str());
+    }
+
+    return reloaded;
+}
+
+
+// programs partages
+struct SharedProgram
+{
+    GLuint program;
+    int references;
+};
+
+static std::unordered_map<std::string, SharedProgram> shared_programs;
+
+GLuint read_shared_program( const char *filename, const char *definitions )
+{
+    std::string key= std::string(filename).append(1, '\n').append(definitions);
+
+    auto found= shared_programs.find(key);
+    if(found != shared_programs.end())
+    {
+        found->second.references++;
+        return found->second.program;
+    }
+
+    SharedProgram shared= { read_program_async(filename, definitions), 1 };
+    shared_programs.insert(std::make_pair(key, shared));
+    return shared.program;
+}
+
+int release_shared_program( const GLuint program )
+{
+    for(auto it= shared_programs.begin(); it != shared_programs.end(); ++it)
+    {
+        if(it->second.program != program)
+            continue;
+
+        if(--it->second.references == 0)
+        {
+            release_program(program);
+            shared_programs.erase(it);
+        }
+        return 0;
+    }
+
+    return -1;
+}
+
 int release_program( const GLuint program )
 {
     if(program == 0)
         return -1;
 
     // recupere les shaders
-    int shaders_max= 0;
-    glGetProgramiv(program, GL_ATTACHED_SHADERS, &shaders_max);
+    release_shaders(program);
+    // ceux de la version rechargee
+    release_update(program);
 
-    if(shaders_max > 0)
+    // et la nouvelle version en cours de compilation
+    auto watched= watched_programs.find(program);
+    if(watched != watched_programs.end())
     {
-        std::vector<GLuint> shaders(shaders_max, 0);
-        glGetAttachedShaders(program, shaders_max, NULL, &shaders.front());
-        for(int i= 0; i < shaders_max; i++)
-        {
-            glDetachShader(program, shaders[i]);
-            glDeleteShader(shaders[i]);
-        }
+        GLuint pending= watched->second.pending;
+        watched_programs.erase(watched);
+        if(pending)
+            release_program(pending);
     }
 
+    program_builds.erase(program);
+    uniform_tables.erase(program);
+    state_forget_program(program);
     glDeleteProgram(program);
     return 0;
 }
@@ -325,15 +887,18 @@ int program_format_errors( const GLuint program, std::string& errors )
         return -1;
     }
 
+    // derniere version du program, cf update_programs( )
+    const GLuint object= state_program_object(program);
+
     GLint status;
-    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    glGetProgramiv(object, GL_LINK_STATUS, &status);
     if(status == GL_TRUE)
         return 0;
 
     int first_error= INT_MAX;
     // recupere les shaders
     int shaders_max= 0;
-    glGetProgramiv(program, GL_ATTACHED_SHADERS, &shaders_max);
+    glGetProgramiv(object, GL_ATTACHED_SHADERS, &shaders_max);
     if(shaders_max == 0)
     {
         errors.append("[error] no shaders...\n");
@@ -341,7 +906,7 @@ int program_format_errors( const GLuint program, std::string& errors )
     }
 
     std::vector<GLuint> shaders(shaders_max, 0);
-    glGetAttachedShaders(program, shaders_max, NULL, &shaders.front());
+    glGetAttachedShaders(object, shaders_max, NULL, &shaders.front());
     for(int i= 0; i < shaders_max; i++)
     {
         GLint value;
@@ -370,10 +935,10 @@ int program_format_errors( const GLuint program, std::string& errors )
     // recupere les erreurs de link du program
     {
         GLint value= 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &value);
+        glGetProgramiv(object, GL_INFO_LOG_LENGTH, &value);
 
         std::vector<char>log(value+1, 0);
-        glGetProgramInfoLog(program, (GLsizei) log.size(), NULL, &log.front());
+        glGetProgramInfoLog(object, (GLsizei) log.size(), NULL, &log.front());
 
         errors.append("[error] linking program...\n").append(log.begin(), log.end());
     }
@@ -22,9 +22,67 @@ GLuint read_program( const char *filename, const char *definitions= "" );
 //! detruit les shaders et le program.
 int release_program( const GLuint program );
 
+/*! cree un shader program, comme read_program( ), mais n'attend pas la fin de la compilation et du link.
+    le program n'est utilisable qu'apres program_ready( ). utilise GL_KHR_parallel_shader_compile si possible.
+*/
+GLuint read_program_async( const char *filename, const char *definitions= "" );
+
+//! renvoie vrai si le program est linke et utilisable, sans bloquer. a appeler a chaque image tant que le program n'est pas pret.
+//! affiche les erreurs de compilation, si necessaire.
+//! sans GL_KHR_parallel_shader_compile, le link est verifie 1 image plus tard, et attend la fin de la compilation si elle n'est pas terminee.
+bool program_ready( const GLuint program );
+
+/*! recharge les programs dont le source a change : la nouvelle version est compilee en tache de fond et ne remplace
+    le program qu'apres un link sans erreur. a appeler une fois par image, cf App::run( ).
+    le program conserve son identifiant, mais la nouvelle version est un autre objet openGL, cf state_redirect_program( ) :
+    l'ancienne version reste utilisee pendant la compilation et en cas d'erreur.
+    renvoie le nombre de programs remplaces.
+*/
+int update_programs( );
+
+/*! renvoie un shader program partage par toute l'application : un seul program par fichier et definitions, compile au premier appel,
+    sans attendre, cf program_ready( ).
+    a detruire avec release_shared_program( ), le program est detruit apres la derniere utilisation.
+
+    remarque : read_program( ) conserve le binaire des programs dans le repertoire program_cache/, il n'est recompile que si
+    le source, les definitions ou le driver changent.
+*/
+GLuint read_shared_program( const char *filename, const char *definitions= "" );
+
+//! detruit un program partage, cf read_shared_program( ).
+int release_shared_program( const GLuint program );
+
 //! recharge les sources et recompile un shader program.
 int reload_program( const GLuint program, const char *filename, const char *definitions= "" );
 
+//! renvoie l'identifiant d'un uniform du program, sans interroger openGL : les uniforms sont recuperes une seule fois, apres le link.\n
+//! renvoie -1 si l'uniform n'existe pas (ou n'est pas utilise par les shaders).
+GLint program_uniform_location( const GLuint program, const char *uniform );
+
+//! uniforms utilises par Mesh::draw( ), identifiants resolus une seule fois apres le link, cf program_uniform_slots( ).
+enum UniformSlot
+{
+    UNIFORM_MODEL_MATRIX= 0,    //!< modelMatrix
+    UNIFORM_NORMAL_MATRIX,      //!< normalMatrix
+    UNIFORM_MESH_COLOR,         //!< mesh_color
+    UNIFORM_DIFFUSE_COLOR,      //!< diffuse_color, texture
+    UNIFORM_LIGHT,              //!< light
+    UNIFORM_LIGHT_COLOR,        //!< light_color
+    UNIFORM_ALPHA_MIN,          //!< alpha_min
+    UNIFORM_POSITION_SCALE,     //!< position_scale
+    UNIFORM_POSITION_OFFSET,    //!< position_offset
+    UNIFORM_SLOTS
+};
+
+//! enregistre un autre uniform dans la table des identifiants de chaque program, renvoie son indice. a appeler une seule fois par nom.
+int uniform_slot( const char *uniform );
+//! renvoie les identifiants des uniforms du program, indexes par UniformSlot ou par uniform_slot( ), -1 si le program n'utilise pas l'uniform.\n
+//! le tableau est reconstruit a chaque link, a relire avant chaque draw.
+const GLint *program_uniform_slots( const GLuint program );
+
+//! binding du uniform block camera, cf camera_uniforms( ).
+static const GLuint CAMERA_BINDING= 1;
+
 //! renvoie les erreurs de compilation.
 int program_format_errors( const GLuint program, std::string& errors );
 
@@ -7,6 +7,15 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctype.h>
+#include <cfloat>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "rgbe.h"
 
@@ -278,11 +287,10 @@ int RGBE_ReadPixels( FILE *fp, float *data, const int n )
 /* save some space.  For each scanline, each channel (r,g,b,e) is */
 /* encoded separately for better compression. */
 
-static int RGBE_WriteBytes_RLE( FILE *fp, const unsigned char *data, const int numbytes )
+static void RGBE_EncodeBytes_RLE( std::vector<unsigned char>& out, const unsigned char *data, const int numbytes )
 {
 #define MINRUNLENGTH 4
     int cur, beg_run, run_count, old_run_count, nonrun_count;
-    unsigned char buf[2];
     
     cur = 0;
     while ( cur < numbytes )
@@ -302,10 +310,8 @@ static int RGBE_WriteBytes_RLE( FILE *fp, const unsigned char *data, const int n
         /* if data before next big run is a short run then write it as such */
         if (( old_run_count > 1 ) && ( old_run_count == beg_run - cur ) )
         {
-            buf[0] = 128 + old_run_count;   /*write short run*/
-            buf[1] = data[cur];
-            if ( fwrite( buf, sizeof( buf[0] )*2, 1, fp ) < 1 )
-                return rgbe_error( rgbe_write_error, NULL );
+            out.push_back( 128 + old_run_count );   /*write short run*/
+            out.push_back( data[cur] );
             cur = beg_run;
         }
         /* write out bytes until we reach the start of the next run */
@@ -314,27 +320,30 @@ static int RGBE_WriteBytes_RLE( FILE *fp, const unsigned char *data, const int n
             nonrun_count = beg_run - cur;
             if ( nonrun_count > 128 )
                 nonrun_count = 128;
-            buf[0] = nonrun_count;
-            if ( fwrite( buf, sizeof( buf[0] ), 1, fp ) < 1 )
-                return rgbe_error( rgbe_write_error, NULL );
-            if ( fwrite( &data[cur], sizeof( data[0] )*nonrun_count, 1, fp ) < 1 )
-                return rgbe_error( rgbe_write_error, NULL );
+            out.push_back( nonrun_count );
+            out.insert( out.end(), &data[cur], &data[cur] + nonrun_count );
             cur += nonrun_count;
         }
         /* write out next run if one was found */
         if ( run_count >= MINRUNLENGTH )
         {
-            buf[0] = 128 + run_count;
-            buf[1] = data[beg_run];
-            if ( fwrite( buf, sizeof( buf[0] )*2, 1, fp ) < 1 )
-                return rgbe_error( rgbe_write_error, NULL );
+            out.push_back( 128 + run_count );
+            out.push_back( data[beg_run] );
             cur += run_count;
         }
     }
-    return RGBE_RETURN_SUCCESS;
 #undef MINRUNLENGTH
 }
 
+static int RGBE_WriteBytes_RLE( FILE *fp, const unsigned char *data, const int numbytes )
+{
+    std::vector<unsigned char> buffer;
+    RGBE_EncodeBytes_RLE( buffer, data, numbytes );
+    if ( buffer.size() > 0 && fwrite( &buffer[0], buffer.size(), 1, fp ) < 1 )
+        return rgbe_error( rgbe_write_error, NULL );
+    return RGBE_RETURN_SUCCESS;
+}
+
 int RGBE_WritePixels_RLE( FILE *fp, const float *data, const int width, const int n )
 {
     unsigned char rgbe[4];
@@ -485,3 +494,340 @@ int RGBE_ReadPixels_RLE( FILE *fp, float *data, const int width, const int n )
     return RGBE_RETURN_SUCCESS;
 }
 
+
+/* The code below decodes and encodes whole images in memory. */
+/* The scanlines are located first, then each thread decodes or encodes */
+/* a band of scanlines. Conversions between rgbe and floats work on */
+/* 4 pixels at once with sse2, and give the same values as rgbe2float */
+/* and float2rgbe. */
+
+/* splits the scanlines in bands, one per thread */
+template < typename Function >
+static void RGBE_ParallelScanlines( const int scanline_width, const int num_scanlines, const Function& function )
+{
+    unsigned int threads = std::max( 1u, std::thread::hardware_concurrency() );
+    /* at least 64k pixels per thread */
+    threads = std::min( threads, ( unsigned int )( ( size_t ) scanline_width * num_scanlines / 65536 ) + 1 );
+    
+    std::vector<std::thread> workers;
+    int band = ( num_scanlines + threads - 1 ) / threads;
+    for ( int y = band; y < num_scanlines; y += band )
+        workers.push_back( std::thread( function, y, std::min( y + band, num_scanlines ) ) );
+    function( 0, std::min( band, num_scanlines ) );
+    
+    for ( size_t i = 0; i < workers.size(); i++ )
+        workers[i].join();
+}
+
+/* rgbe2float : scale[e] = ldexp(1.0, e - 136), 0 for e = 0 */
+struct RGBE_ScaleTable
+{
+    float scale[256];
+    
+    RGBE_ScaleTable( )
+    {
+        scale[0] = 0;
+        for ( int e = 1; e < 256; e++ )
+            scale[e] = std::ldexp( 1.0, e - ( int )( 128 + 8 ) );
+    }
+};
+
+/* built once, thread safe : the scanlines are decoded by several threads */
+static const float *RGBE_Scale( )
+{
+    static const RGBE_ScaleTable table;
+    return table.scale;
+}
+
+/* float2rgbe : v < 1e-32 is compared as a double, find the float threshold */
+static float RGBE_MinFloat( )
+{
+    float f = ( float ) 1e-32;
+    if ( ( double ) f < 1e-32 )
+        f = std::nextafter( f, FLT_MAX );
+    return f;
+}
+
+/* one scanline stored as 4 planes (r, g, b, e) to floats */
+static void RGBE_PlanesToFloat( const unsigned char *planes, const int width, float *data, const int channels )
+{
+    const unsigned char *r = planes;
+    const unsigned char *g = planes + width;
+    const unsigned char *b = planes + 2 * width;
+    const unsigned char *e = planes + 3 * width;
+    const float *rgbe_scale = RGBE_Scale();
+    
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 one = _mm_set1_ps( channels == 4 ? 1.0f : 0.0f );
+    for ( ; i + 4 <= width; i += 4 )
+    {
+        /* exponents 1 to 9 : denormal scales, scalar code */
+        int small = 0;
+        for ( int k = 0; k < 4; k++ )
+            small |= ( e[i + k] != 0 && e[i + k] < 10 );
+        if ( small )
+            break;
+        
+        int32_t tmp;
+        memcpy( &tmp, e + i, 4 );
+        __m128i exponent = _mm_unpacklo_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( tmp ), zero ), zero );
+        /* 2^(e - 136), float exponent field is e - 136 + 127 */
+        __m128i bits = _mm_slli_epi32( _mm_sub_epi32( exponent, _mm_set1_epi32( 9 ) ), 23 );
+        __m128 scale = _mm_andnot_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( exponent, zero ) ), _mm_castsi128_ps( bits ) );
+        
+        __m128 c[4];
+        const unsigned char *plane[3] = { r, g, b };
+        for ( int k = 0; k < 3; k++ )
+        {
+            memcpy( &tmp, plane[k] + i, 4 );
+            __m128i v = _mm_unpacklo_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( tmp ), zero ), zero );
+            c[k] = _mm_mul_ps( _mm_cvtepi32_ps( v ), scale );
+        }
+        c[3] = one;
+        _MM_TRANSPOSE4_PS( c[0], c[1], c[2], c[3] );
+        
+        float *pixel = data + i * channels;
+        if ( channels == 4 )
+        {
+            for ( int k = 0; k < 4; k++ )
+                _mm_storeu_ps( pixel + 4 * k, c[k] );
+        }
+        else
+        {
+            /* overlapping stores, the last pixel writes 3 floats */
+            for ( int k = 0; k < 3; k++ )
+                _mm_storeu_ps( pixel + 3 * k, c[k] );
+            float last[4];
+            _mm_storeu_ps( last, c[3] );
+            memcpy( pixel + 9, last, 3 * sizeof( float ) );
+        }
+    }
+#endif
+    
+    for ( ; i < width; i++ )
+    {
+        float f = rgbe_scale[e[i]];
+        float *pixel = data + i * channels;
+        pixel[RGBE_DATA_RED] = r[i] * f;
+        pixel[RGBE_DATA_GREEN] = g[i] * f;
+        pixel[RGBE_DATA_BLUE] = b[i] * f;
+        if ( channels == 4 )
+            pixel[3] = 1.0f;
+    }
+}
+
+/* one scanline of floats to 4 planes (r, g, b, e) */
+static void RGBE_FloatToPlanes( const float *data, const int channels, const int width, unsigned char *planes )
+{
+    unsigned char *r = planes;
+    unsigned char *g = planes + width;
+    unsigned char *b = planes + 2 * width;
+    unsigned char *e = planes + 3 * width;
+    
+    int i = 0;
+#ifdef __SSE2__
+    const __m128 threshold = _mm_set1_ps( RGBE_MinFloat() );
+    const __m128i exponent_mask = _mm_set1_epi32( 0xff );
+    for ( ; i + 4 <= width; i += 4 )
+    {
+        const float *pixel = data + i * channels;
+        const int c = channels;
+        __m128 red = _mm_setr_ps( pixel[0], pixel[c], pixel[2 * c], pixel[3 * c] );
+        __m128 green = _mm_setr_ps( pixel[1], pixel[c + 1], pixel[2 * c + 1], pixel[3 * c + 1] );
+        __m128 blue = _mm_setr_ps( pixel[2], pixel[c + 2], pixel[2 * c + 2], pixel[3 * c + 2] );
+        
+        /* inf and nan : scalar code */
+        __m128i special = _mm_or_si128( _mm_or_si128(
+            _mm_cmpeq_epi32( _mm_and_si128( _mm_srli_epi32( _mm_castps_si128( red ), 23 ), exponent_mask ), exponent_mask ),
+            _mm_cmpeq_epi32( _mm_and_si128( _mm_srli_epi32( _mm_castps_si128( green ), 23 ), exponent_mask ), exponent_mask ) ),
+            _mm_cmpeq_epi32( _mm_and_si128( _mm_srli_epi32( _mm_castps_si128( blue ), 23 ), exponent_mask ), exponent_mask ) );
+        if ( _mm_movemask_epi8( special ) )
+            break;
+        
+        __m128 v = _mm_max_ps( _mm_max_ps( red, green ), blue );
+        __m128i zero = _mm_castps_si128( _mm_cmplt_ps( v, threshold ) );
+        
+        /* frexp(v) * 256 / v = 2^(8 - e), e = float exponent field - 126 */
+        __m128i exponent = _mm_and_si128( _mm_srli_epi32( _mm_castps_si128( v ), 23 ), exponent_mask );
+        /* largest exponent : e + 128 overflows the byte, scalar code */
+        if ( _mm_movemask_epi8( _mm_cmpgt_epi32( exponent, _mm_set1_epi32( 253 ) ) ) )
+            break;
+        __m128 scale = _mm_castsi128_ps( _mm_slli_epi32( _mm_sub_epi32( _mm_set1_epi32( 261 ), exponent ), 23 ) );
+        
+        __m128i rc = _mm_cvttps_epi32( _mm_mul_ps( red, scale ) );
+        __m128i gc = _mm_cvttps_epi32( _mm_mul_ps( green, scale ) );
+        __m128i bc = _mm_cvttps_epi32( _mm_mul_ps( blue, scale ) );
+        __m128i ec = _mm_add_epi32( exponent, _mm_set1_epi32( 2 ) );
+        
+        /* r0 r1 r2 r3 g0 .. b0 .. e0 .. e3 */
+        __m128i bytes = _mm_packus_epi16( _mm_packs_epi32( rc, gc ), _mm_packs_epi32( bc, ec ) );
+        bytes = _mm_andnot_si128( _mm_packs_epi16( _mm_packs_epi32( zero, zero ), _mm_packs_epi32( zero, zero ) ), bytes );
+        
+        int32_t tmp[4];
+        _mm_storeu_si128( ( __m128i * ) tmp, bytes );
+        memcpy( r + i, &tmp[0], 4 );
+        memcpy( g + i, &tmp[1], 4 );
+        memcpy( b + i, &tmp[2], 4 );
+        memcpy( e + i, &tmp[3], 4 );
+    }
+#endif
+    
+    for ( ; i < width; i++ )
+    {
+        unsigned char rgbe[4];
+        const float *pixel = data + i * channels;
+        float2rgbe( rgbe, pixel[RGBE_DATA_RED], pixel[RGBE_DATA_GREEN], pixel[RGBE_DATA_BLUE] );
+        r[i] = rgbe[0];
+        g[i] = rgbe[1];
+        b[i] = rgbe[2];
+        e[i] = rgbe[3];
+    }
+}
+
+int RGBE_DecodePixels_RLE( const unsigned char *data, const size_t size, float *pixels, const int channels, const int width, const int n, const int flip )
+{
+    int scanline_width = width;
+    int num_scanlines = n;
+    
+    /* locate the run length encoded scanlines, the other ones are flat */
+    std::vector<size_t> offsets( num_scanlines );
+    int flat_scanline = 0;
+    size_t pos = 0;
+    if (( scanline_width >= 8 ) && ( scanline_width <= 0x7fff ) )
+    {
+        for ( flat_scanline = 0; flat_scanline < num_scanlines; flat_scanline++ )
+        {
+            if ( pos + 4 > size )
+                return rgbe_error( rgbe_format_error, "truncated scanline data" );
+            const unsigned char *rgbe = data + pos;
+            if (( rgbe[0] != 2 ) || ( rgbe[1] != 2 ) || ( rgbe[2] & 0x80 ) )
+                /* this file is not run length encoded, from this scanline */
+                break;
+            if (((( int )rgbe[2] ) << 8 | rgbe[3] ) != scanline_width )
+                return rgbe_error( rgbe_format_error, "wrong scanline width" );
+            
+            pos += 4;
+            offsets[flat_scanline] = pos;
+            for ( int i = 0; i < 4; i++ )
+            {
+                int count;
+                for ( int x = 0; x < scanline_width; x += count )
+                {
+                    if ( pos + 2 > size )
+                        return rgbe_error( rgbe_format_error, "truncated scanline data" );
+                    if ( data[pos] > 128 )
+                    {
+                        count = data[pos] - 128;
+                        pos += 2;
+                    }
+                    else
+                    {
+                        count = data[pos];
+                        pos += 1 + count;
+                    }
+                    if (( count == 0 ) || ( count > scanline_width - x ) || ( pos > size ) )
+                        return rgbe_error( rgbe_format_error, "bad scanline data" );
+                }
+            }
+        }
+    }
+    
+    const size_t flat_offset = pos;
+    if ( ( size - flat_offset ) / 4 < ( size_t ) scanline_width * ( num_scanlines - flat_scanline ) )
+        return rgbe_error( rgbe_format_error, "truncated pixel data" );
+    
+    RGBE_ParallelScanlines( scanline_width, num_scanlines,
+        [=, &offsets]( const int begin, const int end )
+        {
+            std::vector<unsigned char> planes( 4 * scanline_width );
+            for ( int y = begin; y < end; y++ )
+            {
+                if ( y < flat_scanline )
+                {
+                    const unsigned char *ptr = data + offsets[y];
+                    for ( int i = 0; i < 4; i++ )
+                    {
+                        unsigned char *plane = &planes[i * scanline_width];
+                        for ( int x = 0; x < scanline_width; )
+                        {
+                            if ( ptr[0] > 128 )
+                            {
+                                /* a run of the same values */
+                                int count = ptr[0] - 128;
+                                memset( plane + x, ptr[1], count );
+                                ptr += 2;
+                                x += count;
+                            }
+                            else
+                            {
+                                /* a non-run */
+                                int count = ptr[0];
+                                memcpy( plane + x, ptr + 1, count );
+                                ptr += 1 + count;
+                                x += count;
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    const unsigned char *ptr = data + flat_offset + ( size_t )( y - flat_scanline ) * scanline_width * 4;
+                    for ( int x = 0; x < scanline_width; x++, ptr += 4 )
+                        for ( int i = 0; i < 4; i++ )
+                            planes[i * scanline_width + x] = ptr[i];
+                }
+                
+                int line = flip ? num_scanlines - 1 - y : y;
+                RGBE_PlanesToFloat( &planes[0], scanline_width, pixels + ( size_t ) line * scanline_width * channels, channels );
+            }
+        } );
+    
+    return RGBE_RETURN_SUCCESS;
+}
+
+int RGBE_EncodePixels_RLE( FILE *fp, const float *pixels, const int channels, const int width, const int n, const int flip )
+{
+    int scanline_width = width;
+    int num_scanlines = n;
+    bool rle = ( scanline_width >= 8 ) && ( scanline_width <= 0x7fff );
+    
+    /* encodes the scanlines in parallel, then writes them in order */
+    std::vector< std::vector<unsigned char> > scanlines( num_scanlines );
+    RGBE_ParallelScanlines( scanline_width, num_scanlines,
+        [=, &scanlines]( const int begin, const int end )
+        {
+            std::vector<unsigned char> planes( 4 * scanline_width );
+            for ( int y = begin; y < end; y++ )
+            {
+                int line = flip ? num_scanlines - 1 - y : y;
+                RGBE_FloatToPlanes( pixels + ( size_t ) line * scanline_width * channels, channels, scanline_width, &planes[0] );
+                
+                std::vector<unsigned char>& out = scanlines[y];
+                if ( !rle )
+                {
+                    /* run length encoding is not allowed so write flat*/
+                    out.resize( 4 * scanline_width );
+                    for ( int x = 0; x < scanline_width; x++ )
+                        for ( int i = 0; i < 4; i++ )
+                            out[4 * x + i] = planes[i * scanline_width + x];
+                    continue;
+                }
+                
+                out.push_back( 2 );
+                out.push_back( 2 );
+                out.push_back( scanline_width >> 8 );
+                out.push_back( scanline_width & 0xFF );
+                /* first red, then green, then blue, then exponent */
+                for ( int i = 0; i < 4; i++ )
+                    RGBE_EncodeBytes_RLE( out, &planes[i * scanline_width], scanline_width );
+            }
+        } );
+    
+    for ( int y = 0; y < num_scanlines; y++ )
+        if ( scanlines[y].size() > 0 && fwrite( &scanlines[y][0], scanlines[y].size(), 1, fp ) < 1 )
+            return rgbe_error( rgbe_write_error, NULL );
+    
+    return RGBE_RETURN_SUCCESS;
+}
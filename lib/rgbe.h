@@ -9,6 +9,7 @@
 */
 
 #include <cstdio>
+#include <cstddef>
 
 typedef struct {
   int valid;            /* indicate which fields are valid */
@@ -45,6 +46,12 @@ int RGBE_ReadPixels(FILE *fp, float *data, const int numpixels);
 int RGBE_WritePixels_RLE(FILE *fp, const float *data, const int scanline_width, const int num_scanlines);
 int RGBE_ReadPixels_RLE(FILE *fp, float *data, const int scanline_width, const int num_scanlines);
 
+/* decode or encode a whole image in memory, scanlines in parallel */
+/* pixels have 3 (rgb) or 4 (rgba, alpha= 1) floats, flip reverses the scanline order */
+/* data points to the pixels after the header, cf RGBE_ReadHeader and ftell */
+int RGBE_DecodePixels_RLE(const unsigned char *data, const size_t size, float *pixels, const int channels, const int scanline_width, const int num_scanlines, const int flip);
+int RGBE_EncodePixels_RLE(FILE *fp, const float *pixels, const int channels, const int scanline_width, const int num_scanlines, const int flip);
+
 #endif /* _H_RGBE */
 
 
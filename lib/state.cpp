@@ -0,0 +1,261 @@
+
+//! \file state.cpp
+
+#include <cstring>
+#include <unordered_map>
+
+#include "state.h"
+
+
+// etat connu, ~0u : inconnu
+static const GLuint unknown= ~0u;
+static const int units_max= 16;
+
+static GLuint current_program= unknown;
+static GLuint current_vao= unknown;
+static int current_unit= -1;
+static GLuint current_textures[units_max];
+static GLuint current_samplers[units_max];
+static GLenum current_blend[2]= { 0, 0 };
+static GLenum current_polygon_mode= 0;
+
+// glEnable / glDisable : quelques fonctionnalites suffisent
+static const GLenum capabilities[]= { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_PRIMITIVE_RESTART, GL_FRAMEBUFFER_SRGB };
+static const int capabilities_max= sizeof(capabilities) / sizeof(capabilities[0]);
+static int current_capabilities[capabilities_max];     // -1 inconnu, 0 desactive, 1 active
+
+static bool initialized= false;
+
+static StateCounters counters[STATE_CATEGORIES];
+static StateCounters frame_counters[STATE_CATEGORIES];
+
+enum { PROGRAM= 0, VAO, TEXTURE, CAPABILITY };
+
+static
+void init( )
+{
+    if(initialized)
+        return;
+    state_invalidate();
+}
+
+// compte une demande, renvoie vrai si elle change l'etat
+static
+bool request( const int category, const bool change )
+{
+    counters[category].requests++;
+    if(change)
+        counters[category].changes++;
+    return change;
+}
+
+
+void state_invalidate( )
+{
+    current_program= unknown;
+    current_vao= unknown;
+    current_unit= -1;
+    for(int i= 0; i < units_max; i++)
+    {
+        current_textures[i]= unknown;
+        current_samplers[i]= unknown;
+    }
+    current_blend[0]= 0;
+    current_blend[1]= 0;
+    current_polygon_mode= 0;
+    for(int i= 0; i < capabilities_max; i++)
+        current_capabilities[i]= -1;
+
+    initialized= true;
+}
+
+// programs recharges : identifiant connu de l'application -> objet openGL de la derniere version, cf update_programs( )
+static std::unordered_map<GLuint, GLuint> program_objects;
+
+GLuint state_program_object( const GLuint program )
+{
+    auto found= program_objects.find(program);
+    return (found != program_objects.end()) ? found->second : program;
+}
+
+void state_redirect_program( const GLuint program, const GLuint object )
+{
+    if(object == program)
+        program_objects.erase(program);
+    else
+        program_objects[program]= object;
+    
+    // l'ancien objet est peut etre encore selectionne
+    if(current_program == program)
+        current_program= unknown;
+}
+
+void state_use_program( const GLuint program )
+{
+    init();
+    if(request(PROGRAM, program != current_program))
+    {
+        glUseProgram(state_program_object(program));
+        current_program= program;
+    }
+}
+
+GLuint state_current_program( )
+{
+    init();
+    if(current_program == unknown)
+    {
+        GLint object= 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &object);
+        current_program= object;
+        for(auto it= program_objects.begin(); it != program_objects.end(); ++it)
+            if(it->second == (GLuint) object)
+                current_program= it->first;
+    }
+    return current_program;
+}
+
+void state_bind_vertex_array( const GLuint vao )
+{
+    init();
+    if(request(VAO, vao != current_vao))
+    {
+        glBindVertexArray(vao);
+        current_vao= vao;
+    }
+}
+
+static
+void active_unit( const int unit )
+{
+    if(unit != current_unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        current_unit= unit;
+    }
+}
+
+void state_bind_texture( const int unit, const GLuint texture )
+{
+    init();
+    if(unit < 0 || unit >= units_max)
+    {
+        // pas dans le cache
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        current_unit= -1;
+        return;
+    }
+
+    // l'unite reste selectionnee, pour configurer la texture apres l'appel
+    active_unit(unit);
+    if(request(TEXTURE, texture != current_textures[unit]))
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        current_textures[unit]= texture;
+    }
+}
+
+void state_bind_sampler( const int unit, const GLuint sampler )
+{
+    init();
+    if(unit < 0 || unit >= units_max)
+    {
+        glBindSampler(unit, sampler);
+        return;
+    }
+
+    if(request(TEXTURE, sampler != current_samplers[unit]))
+    {
+        glBindSampler(unit, sampler);
+        current_samplers[unit]= sampler;
+    }
+}
+
+void state_enable( const GLenum capability, const bool enable )
+{
+    init();
+    int index= -1;
+    for(int i= 0; i < capabilities_max; i++)
+        if(capabilities[i] == capability)
+            index= i;
+
+    if(index < 0 || request(CAPABILITY, current_capabilities[index] != int(enable)))
+    {
+        if(enable)
+            glEnable(capability);
+        else
+            glDisable(capability);
+
+        if(index >= 0)
+            current_capabilities[index]= int(enable);
+    }
+}
+
+void state_blend_func( const GLenum source, const GLenum destination )
+{
+    init();
+    if(request(CAPABILITY, source != current_blend[0] || destination != current_blend[1]))
+    {
+        glBlendFunc(source, destination);
+        current_blend[0]= source;
+        current_blend[1]= destination;
+    }
+}
+
+void state_polygon_mode( const GLenum mode )
+{
+    init();
+    if(request(CAPABILITY, mode != current_polygon_mode))
+    {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+        current_polygon_mode= mode;
+    }
+}
+
+void state_delete_textures( const int n, const GLuint *textures )
+{
+    init();
+    // openGL detache les textures detruites de toutes les unites
+    for(int i= 0; i < n; i++)
+    for(int u= 0; u < units_max; u++)
+        if(current_textures[u] == textures[i])
+            current_textures[u]= 0;
+
+    glDeleteTextures(n, textures);
+}
+
+void state_delete_vertex_arrays( const int n, const GLuint *vaos )
+{
+    init();
+    for(int i= 0; i < n; i++)
+        if(current_vao == vaos[i])
+            current_vao= 0;
+
+    glDeleteVertexArrays(n, vaos);
+}
+
+void state_forget_program( const GLuint program )
+{
+    // le program reste utilise jusqu'au prochain glUseProgram, mais son identifiant peut etre reutilise
+    if(current_program == program)
+        current_program= unknown;
+}
+
+
+const StateCounters& state_counters( const int category )
+{
+    return frame_counters[category];
+}
+
+const char *state_category_name( const int category )
+{
+    static const char *names[]= { "program", "vao", "texture", "state" };
+    return names[category];
+}
+
+void state_frame( )
+{
+    memcpy(frame_counters, counters, sizeof(counters));
+    memset(counters, 0, sizeof(counters));
+}
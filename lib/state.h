@@ -0,0 +1,73 @@
+
+#ifndef _STATE_H
+#define _STATE_H
+
+#include "glcore.h"
+
+
+//! \addtogroup openGL utilitaires openGL
+///@{
+
+/*! \file
+cache de l'etat openGL : les changements d'etat redondants (program, vertex array, textures, samplers, glEnable / glDisable, blend)
+ne sont pas transmis au driver. mesh, text et uniforms utilisent ces fonctions.
+
+remarque : le cache ne connait que les changements d'etat faits par ces fonctions, il faut appeler state_invalidate( )
+apres avoir modifie l'etat directement avec openGL.
+*/
+
+//! selectionne un shader program, cf glUseProgram( ).
+void state_use_program( const GLuint program );
+//! renvoie le shader program selectionne, sans interroger openGL.
+GLuint state_current_program( );
+
+//! selectionne un vertex array object, cf glBindVertexArray( ).
+void state_bind_vertex_array( const GLuint vao );
+
+//! selectionne une texture 2d sur une unite de texture, cf glActiveTexture( ) et glBindTexture( ). l'unite reste active.
+void state_bind_texture( const int unit, const GLuint texture );
+//! selectionne les parametres de filtrage d'une unite de texture, cf glBindSampler( ).
+void state_bind_sampler( const int unit, const GLuint sampler );
+
+//! active ou desactive une fonctionnalite du pipeline, cf glEnable( ) et glDisable( ).
+void state_enable( const GLenum capability, const bool enable= true );
+//! desactive une fonctionnalite du pipeline.
+inline void state_disable( const GLenum capability ) { state_enable(capability, false); }
+//! configure le melange des couleurs, cf glBlendFunc( ).
+void state_blend_func( const GLenum source, const GLenum destination );
+//! configure le remplissage des triangles, cf glPolygonMode( ).
+void state_polygon_mode( const GLenum mode );
+
+//! detruit des textures, les oublie dans le cache, cf glDeleteTextures( ).
+void state_delete_textures( const int n, const GLuint *textures );
+//! detruit des vertex arrays, les oublie dans le cache, cf glDeleteVertexArrays( ).
+void state_delete_vertex_arrays( const int n, const GLuint *vaos );
+//! oublie un shader program detruit, cf release_program( ).
+void state_forget_program( const GLuint program );
+//! le shader program program est execute par l'objet openGL object, cf update_programs( ). object == program supprime la redirection.
+void state_redirect_program( const GLuint program, const GLuint object );
+//! renvoie l'objet openGL qui execute le shader program, program sans redirection.
+GLuint state_program_object( const GLuint program );
+
+//! oublie l'etat connu, les prochains changements seront tous transmis a openGL.
+void state_invalidate( );
+
+//! compteurs de changements d'etat : demandes et transmis au driver.
+struct StateCounters
+{
+    int requests;
+    int changes;
+};
+
+//! changements d'etat de l'image precedente, par categorie : 0 program, 1 vertex array, 2 textures et samplers, 3 enable / blend / polygon mode.
+const StateCounters& state_counters( const int category );
+//! nombre de categories.
+static const int STATE_CATEGORIES= 4;
+//! nom d'une categorie.
+const char *state_category_name( const int category );
+
+//! termine une image, conserve les compteurs, cf App::run( ).
+void state_frame( );
+
+///@}
+#endif
@@ -4,6 +4,7 @@
 #include <cstdarg>
 
 #include "program.h"
+#include "state.h"
 #include "uniforms.h"
 #include "image.h"
 #include "image_io.h"
@@ -16,7 +17,14 @@ Text create_text( )
     Text text;
 
     // charge la fonte
-    Image font= read_image( smart_path("data/font.png") );
+    // 8 bits par canal, 4x plus petite qu'une Image float
+    ImageRGBA8 font(read_image_data( smart_path("data/font.png") ));
+    if(font.size() == 0)
+    {
+        // pas de fonte, pas de console, cf text_ready( )
+        printf("[error] loading font 'data/font.png', no console...\n");
+        return text;
+    }
 
     // modifie la transparence du caractere de fond
     for(unsigned int y= 0; y < 16; y++)
@@ -24,9 +32,8 @@ Text create_text( )
     {
         unsigned int starty= 16 *7;
         unsigned int startx= 8 *2;
-        Color color= font(startx + x, starty + y);
-        color.a= 0.6f;
-        font(startx + x, starty + y)= color;
+        // alpha 0.6, meme arrondi que write_image( )
+        font(startx + x, starty + y)[3]= ImageChannel<uint8_t>::from_float(0.6f);
     }
 
     // cree le curseur
@@ -36,7 +43,7 @@ Text create_text( )
         unsigned int starty= 16 *7;
         unsigned int startx= 8 *1;
         Color color= (x > 1) ? Color(1, 1, 1, 0.6f) : Color(1, 1, 1, 1);
-        font(startx + x, starty + y)= color;
+        font.color(startx + x, starty + y, color);
     }
 
     text.font= make_texture(0, font);
@@ -46,7 +53,13 @@ Text create_text( )
 
     // shader
     text.program= read_program( smart_path("data/shaders/text.glsl") );
-    program_print_errors(text.program);
+    if(program_print_errors(text.program) < 0)
+    {
+        printf("[error] loading 'data/shaders/text.glsl', no console...\n");
+        release_program(text.program);
+        state_delete_textures(1, &text.font);
+        return Text();
+    }
 
     // associe l'uniform buffer a l'entree 0 / binding 0
     GLint index= glGetUniformBlockIndex(text.program, "textData");
@@ -61,12 +74,20 @@ Text create_text( )
     return text;
 }
 
+bool text_ready( const Text& text )
+{
+    return text.program != 0;
+}
+
 void release_text( Text& text )
 {
+    if(!text_ready(text))
+        return;
+
     release_program(text.program);
-    glDeleteVertexArrays(1, &text.vao);
+    state_delete_vertex_arrays(1, &text.vao);
     glDeleteBuffers(1, &text.ubo);
-    glDeleteTextures(1, &text.font);
+    state_delete_textures(1, &text.font);
 }
 
 void clear( Text& text )
@@ -157,8 +178,11 @@ void default_color( Text& text, const Color& color )
 
 void draw( const Text& text, const int width, const int height )
 {
-    glBindVertexArray(text.vao);
-    glUseProgram(text.program);
+    if(!text_ready(text))
+        return;
+
+    state_bind_vertex_array(text.vao);
+    state_use_program(text.program);
     program_use_texture(text.program, "font", 0, text.font);
 
     program_uniform(text.program, "offset", height - 24*16);
@@ -168,13 +192,13 @@ void draw( const Text& text, const int width, const int height )
     glBindBufferBase(GL_UNIFORM_BUFFER, 0, text.ubo);
     glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(text.buffer), text.buffer);
 
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-    glDisable(GL_DEPTH_TEST);
+    state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    state_enable(GL_BLEND);
+    state_disable(GL_DEPTH_TEST);
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
+    state_disable(GL_BLEND);
+    state_enable(GL_DEPTH_TEST);
 }
 
@@ -70,8 +70,10 @@ struct Text
     GLuint ubo;         //!< uniform buffer object, pour transferrer le texte a afficher
 };
 
-//! cree une console. a detruire avec release_text( ).
+//! cree une console. a detruire avec release_text( ). la console n'est pas utilisable si data/font.png ou data/shaders/text.glsl manquent, cf text_ready( ).
 Text create_text( );
+//! renvoie true si la console peut etre dessinee.
+bool text_ready( const Text& text );
 //! detruit une console.
 void release_text( Text& text );
 
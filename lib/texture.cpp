@@ -4,6 +4,7 @@
 #include <algorithm>
 
 #include "texture.h"
+#include "state.h"
 #include "image_io.h"
 
 
@@ -22,50 +23,45 @@ int miplevels( const int width, const int height )
     return levels;
 }
 
-GLuint make_texture( const int unit, const Image& im, const GLenum texel_type )
+GLuint make_texture( const int unit, const int width, const int height, const GLenum texel_type, const GLenum data_format, const GLenum data_type, const void *data )
 {
-    if(im == Image::error())
-        return 0;
-
     // cree la texture openGL
     GLuint texture;
     glGenTextures(1, &texture);
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    state_bind_texture(unit, texture);
     
     // fixe les parametres de filtrage par defaut
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-
-    // transfere les donnees dans la texture, 4 float par texel
+    
+    // transfere les donnees dans la texture, les lignes rgb 8 bits ne sont pas alignees sur 4 octets
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glTexImage2D(GL_TEXTURE_2D, 0,
-        texel_type, im.width(), im.height(), 0,
-        GL_RGBA, GL_FLOAT, im.buffer());
+        texel_type, width, height, 0,
+        data_format, data_type, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     
     // prefiltre la texture
     glGenerateMipmap(GL_TEXTURE_2D);
     return texture;
 }
 
+GLuint make_texture( const int unit, const Image& im, const GLenum texel_type )
+{
+    if(im == Image::error())
+        return 0;
+    
+    // 4 float par texel
+    return make_texture(unit, im.width(), im.height(), texel_type, GL_RGBA, GL_FLOAT, im.buffer());
+}
+
 GLuint make_texture( const int unit, const ImageData& im, const GLenum texel_type )
 {
     if(im.data.empty())
         return 0;
     
-    // cree la texture openGL
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    
-    // fixe les parametres de filtrage par defaut
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-
     GLenum format;
     switch(im.channels)
     {
@@ -80,21 +76,14 @@ GLuint make_texture( const int unit, const ImageData& im, const GLenum texel_typ
     switch(im.size)
     {
         case 1: type= GL_UNSIGNED_BYTE; break;
+        case 2: type= GL_UNSIGNED_SHORT; break;
         case 4: type= GL_FLOAT; break;
         default: type= GL_UNSIGNED_BYTE;
     }
     
-    // transfere les donnees dans la texture
-    glTexImage2D(GL_TEXTURE_2D, 0,
-        texel_type, im.width, im.height, 0,
-        format, type, im.buffer());
-    
-    // prefiltre la texture
-    glGenerateMipmap(GL_TEXTURE_2D);
-    return texture;
+    return make_texture(unit, im.width, im.height, texel_type, format, type, im.buffer());
 }
 
-
 GLuint read_texture( const int unit, const char *filename, const GLenum texel_type )
 {
     ImageData image= read_image_data(filename);
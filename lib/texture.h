@@ -5,6 +5,7 @@
 #include "glcore.h"
 #include "image.h"
 #include "image_io.h"
+#include "image_typed.h"
 
 
 //! \addtogroup openGL
@@ -22,6 +23,19 @@ GLuint make_texture( const int unit, const Image& im, const GLenum texel_type= G
 //! \param texel_type permet de choisir la representation interne des valeurs de la texture.
 GLuint make_texture( const int unit, const ImageData& im, const GLenum texel_type= GL_RGBA );
 
+//! cree une texture a partir de pixels de format data_format (GL_RED, GL_RGBA, etc.) et de type data_type (GL_UNSIGNED_BYTE, GL_FLOAT, etc.), lignes sans alignement. a detruire avec glDeleteTextures( ).
+GLuint make_texture( const int unit, const int width, const int height, const GLenum texel_type, const GLenum data_format, const GLenum data_type, const void *data );
+
+//! cree une texture a partir d'une image compacte, sans conversion, cf image_typed.h. a detruire avec glDeleteTextures( ).
+//! \param texel_type par defaut, meme precision que l'image : GL_RGBA8 pour ImageRGBA8, GL_RGBA16F pour ImageRGBA16F, etc.
+template < typename T, int N >
+GLuint make_texture( const int unit, const TypedImage<T, N>& im, const GLenum texel_type= TypedImage<T, N>::texel_format() )
+{
+    if(im.size() == 0)
+        return 0;
+    return make_texture(unit, im.width(), im.height(), texel_type, TypedImage<T, N>::data_format(), TypedImage<T, N>::data_type(), im.buffer());
+}
+
 //! cree une texture a partir d'un fichier filename. a detruire avec glDeleteTextures( ).
 //! \param texel_type permet de choisir la representation interne des valeurs de la texture.
 GLuint read_texture( const int unit, const char *filename, const GLenum texel_type= GL_RGBA );
@@ -1,10 +1,12 @@
 
 #include <cstdio>
+#include <cstring>
 
 #include <set>
 
 #include "program.h"
 #include "uniforms.h"
+#include "state.h"
 
 
 static 
@@ -13,8 +15,8 @@ int location( const GLuint program, const char *uniform )
     if(program == 0) 
         return -1;
     
-    // recuperer l'identifiant de l'uniform dans le program
-    GLint location= glGetUniformLocation(program, uniform);
+    // recuperer l'identifiant de l'uniform dans le program, cf la table construite par read_program( )
+    GLint location= program_uniform_location(program, uniform);
     if(location < 0)
     {
         char error[1024]= { 0 };
@@ -39,8 +41,8 @@ int location( const GLuint program, const char *uniform )
     
 #ifndef GK_RELEASE
     // verifier que le program est bien en cours d'utilisation, ou utiliser glProgramUniform, mais c'est gl 4
-    GLuint current;
-    glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *) &current);
+    // le cache d'etat connait le program, pas besoin d'interroger openGL
+    GLuint current= state_current_program();
     if(current != program)
     {
         char error[1024]= { 0 };
@@ -58,7 +60,7 @@ int location( const GLuint program, const char *uniform )
     #endif
         
         printf("%s\n", error);
-        glUseProgram(program);
+        state_use_program(program);
     }
 #endif
     
@@ -115,6 +117,41 @@ void program_uniform( const GLuint program, const char *uniform, const Transform
     glUniformMatrix4fv( location(program, uniform), 1, GL_TRUE, v.buffer() );
 }
 
+// uniform buffer partage par les shaders qui declarent le block camera
+static GLuint camera_buffer= 0;
+static Transform camera_view;
+static Transform camera_projection;
+
+void camera_uniforms( const Transform& view, const Transform& projection )
+{
+    if(camera_buffer == 0)
+    {
+        glGenBuffers(1, &camera_buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, camera_buffer);
+        glBufferData(GL_UNIFORM_BUFFER, 3 * sizeof(Transform), nullptr, GL_DYNAMIC_DRAW);
+        // le binding CAMERA_BINDING n'est utilise par aucun autre buffer
+        glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, camera_buffer);
+    }
+    else if(memcmp(view.buffer(), camera_view.buffer(), sizeof(Transform)) == 0
+    && memcmp(projection.buffer(), camera_projection.buffer(), sizeof(Transform)) == 0)
+        // rien a faire, les matrices n'ont pas change
+        return;
+
+    camera_view= view;
+    camera_projection= projection;
+
+    // meme convention que program_uniform( Transform ) : les matrices sont declarees row_major dans le block
+    Transform matrices[3]= { view, projection, projection * view };
+    glBindBuffer(GL_UNIFORM_BUFFER, camera_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(matrices), matrices);
+}
+
+void release_camera_uniforms( )
+{
+    glDeleteBuffers(1, &camera_buffer);
+    camera_buffer= 0;
+}
+
 void program_use_texture( const GLuint program, const char *uniform, const int unit, const GLuint texture, const GLuint sampler )
 {
     // verifie que l'uniform existe
@@ -122,13 +159,11 @@ void program_use_texture( const GLuint program, const char *uniform, const int u
     if(id < 0)
         return;
     
-    // selectionne l'unite de texture
-    glActiveTexture(GL_TEXTURE0 + unit);
-    // configure la texture
-    glBindTexture(GL_TEXTURE_2D, texture);
+    // selectionne l'unite de texture et configure la texture
+    state_bind_texture(unit, texture);
     
     // les parametres de filtrage
-    glBindSampler(unit, sampler);
+    state_bind_sampler(unit, sampler);
     
     // transmet l'indice de l'unite de texture au shader
     glUniform1i(id, unit);
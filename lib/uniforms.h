@@ -42,6 +42,21 @@ void program_uniform( const GLuint program, const char *uniform, const Color& c
 //! affecte une valeur a un uniform du shader program. Transform.
 void program_uniform( const GLuint program, const char *uniform, const Transform& v );
 
+/*! matrices de la camera, partagees par tous les shaders dans un uniform buffer, mis a jour uniquement si elles changent.
+    les shaders declarent :
+    \code
+    layout(std140, row_major) uniform camera
+    {
+        mat4 viewMatrix;
+        mat4 projectionMatrix;
+        mat4 viewprojMatrix;
+    };
+    \endcode
+*/
+void camera_uniforms( const Transform& view, const Transform& projection );
+//! detruit le buffer des matrices de la camera.
+void release_camera_uniforms( );
+
 //! configure le pipeline et le shader program pour utiliser une texture, et des parametres de filtrages, eventuellement.
 void program_use_texture( const GLuint program, const char *uniform, const int unit, const GLuint texture, const GLuint sampler= 0 );
 
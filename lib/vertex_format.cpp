@@ -0,0 +1,167 @@
+
+//! \file vertex_format.cpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "vertex_format.h"
+
+
+VertexFormat vertex_format_used( const VertexFormat& format, const bool use_texcoord, const bool use_normal, const bool use_color )
+{
+    VertexFormat used= format;
+    if(!use_texcoord) used.texcoord= VERTEX_NONE;
+    if(!use_normal) used.normal= VERTEX_NONE;
+    if(!use_color) used.color= VERTEX_NONE;
+    return used;
+}
+
+std::string vertex_format_definitions( const VertexFormat& format )
+{
+    // les autres encodages sont convertis en float par openGL, cf vertex_format_attributes( )
+    if(format.position == VERTEX_SNORM16)
+        return "#define USE_QUANTIZED_POSITION\n";
+    return "";
+}
+
+
+static unsigned char *encode( const VertexEncoding encoding, const float *v, const int n, unsigned char *data )
+{
+    switch(encoding)
+    {
+        case VERTEX_FLOAT:
+            memcpy(data, v, n * sizeof(float));
+            break;
+        
+        case VERTEX_HALF:
+        {
+            uint16_t h[4]= { 0, 0, 0, 0 };
+            for(int i= 0; i < n; i++)
+                h[i]= float_to_half(v[i]);
+            memcpy(data, h, vertex_encoding_size(encoding, n));
+            break;
+        }
+        
+        case VERTEX_SNORM16:
+        {
+            int16_t s[4]= { 0, 0, 0, 0 };
+            for(int i= 0; i < n; i++)
+                s[i]= int16_t(std::round(std::min(std::max(v[i], -1.f), 1.f) * 32767.f));
+            memcpy(data, s, vertex_encoding_size(encoding, n));
+            break;
+        }
+        
+        case VERTEX_SNORM10:
+        {
+            // x y z sur 10 bits signes, w= 0 
+            uint32_t packed= 0;
+            for(int i= 0; i < 3; i++)
+            {
+                int q= int(std::round(std::min(std::max(v[i], -1.f), 1.f) * 511.f));
+                packed|= (uint32_t(q) & 0x3ffu) << (10*i);
+            }
+            memcpy(data, &packed, sizeof(packed));
+            break;
+        }
+        
+        case VERTEX_UNORM8:
+        {
+            unsigned char c[4]= { 0, 0, 0, 255 };
+            for(int i= 0; i < n; i++)
+                c[i]= (unsigned char) std::round(std::min(std::max(v[i], 0.f), 1.f) * 255.f);
+            memcpy(data, c, 4);
+            break;
+        }
+        
+        case VERTEX_NONE:
+            break;
+    }
+    
+    return data + vertex_encoding_size(encoding, n);
+}
+
+void vertex_encode( const VertexFormat& format, 
+    const std::vector<vec3>& positions, const std::vector<vec2>& texcoords, const std::vector<vec3>& normals, const std::vector<vec4>& colors,
+    std::vector<unsigned char>& buffer, vec3& scale, vec3& offset )
+{
+    scale= vec3(1, 1, 1);
+    offset= vec3(0, 0, 0);
+    if(format.position == VERTEX_SNORM16 && positions.size() > 0)
+    {
+        // quantification dans la boite englobante, centree
+        vec3 pmin= positions[0];
+        vec3 pmax= positions[0];
+        for(unsigned int i= 1; i < (unsigned int) positions.size(); i++)
+        {
+            pmin= vec3(std::min(pmin.x, positions[i].x), std::min(pmin.y, positions[i].y), std::min(pmin.z, positions[i].z));
+            pmax= vec3(std::max(pmax.x, positions[i].x), std::max(pmax.y, positions[i].y), std::max(pmax.z, positions[i].z));
+        }
+        
+        offset= vec3((pmin.x + pmax.x) / 2, (pmin.y + pmax.y) / 2, (pmin.z + pmax.z) / 2);
+        scale= vec3((pmax.x - pmin.x) / 2, (pmax.y - pmin.y) / 2, (pmax.z - pmin.z) / 2);
+    }
+    
+    const size_t count= positions.size();
+    const int stride= format.stride();
+    buffer.resize(count * stride);
+    
+    for(size_t i= 0; i < count; i++)
+    {
+        unsigned char *data= buffer.data() + i * stride;
+        
+        vec3 p= positions[i];
+        if(format.position == VERTEX_SNORM16)
+            p= vec3(scale.x > 0 ? (p.x - offset.x) / scale.x : 0, scale.y > 0 ? (p.y - offset.y) / scale.y : 0, scale.z > 0 ? (p.z - offset.z) / scale.z : 0);
+        data= encode(format.position, &p.x, 3, data);
+        
+        if(format.texcoord != VERTEX_NONE)
+            data= encode(format.texcoord, &texcoords[i].x, 2, data);
+        
+        if(format.normal != VERTEX_NONE)
+        {
+            vec3 n= normals[i];
+            if(format.normal != VERTEX_FLOAT)
+            {
+                // seule la direction est utilisee par les shaders
+                float length= std::sqrt(n.x*n.x + n.y*n.y + n.z*n.z);
+                if(length > 0)
+                    n= vec3(n.x / length, n.y / length, n.z / length);
+            }
+            data= encode(format.normal, &n.x, 3, data);
+        }
+        
+        if(format.color != VERTEX_NONE)
+            data= encode(format.color, &colors[i].x, 4, data);
+    }
+}
+
+
+static void attribute( const GLuint location, const VertexEncoding encoding, const int n, const int stride, const int offset )
+{
+    if(encoding == VERTEX_NONE)
+    {
+        glDisableVertexAttribArray(location);
+        return;
+    }
+    
+    switch(encoding)
+    {
+        case VERTEX_FLOAT:   glVertexAttribPointer(location, n, GL_FLOAT, GL_FALSE, stride, (const void *) size_t(offset)); break;
+        case VERTEX_HALF:    glVertexAttribPointer(location, n, GL_HALF_FLOAT, GL_FALSE, stride, (const void *) size_t(offset)); break;
+        case VERTEX_SNORM16: glVertexAttribPointer(location, n, GL_SHORT, GL_TRUE, stride, (const void *) size_t(offset)); break;
+        case VERTEX_SNORM10: glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (const void *) size_t(offset)); break;
+        case VERTEX_UNORM8:  glVertexAttribPointer(location, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void *) size_t(offset)); break;
+        case VERTEX_NONE: break;
+    }
+    glEnableVertexAttribArray(location);
+}
+
+void vertex_format_attributes( const VertexFormat& format )
+{
+    const int stride= format.stride();
+    attribute(0, format.position, 3, stride, format.position_offset());
+    attribute(1, format.texcoord, 2, stride, format.texcoord_offset());
+    attribute(2, format.normal, 3, stride, format.normal_offset());
+    attribute(3, format.color, 4, stride, format.color_offset());
+}
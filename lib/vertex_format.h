@@ -0,0 +1,100 @@
+
+#ifndef _VERTEX_FORMAT_H
+#define _VERTEX_FORMAT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glcore.h"
+#include "vec.h"
+#include "half.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+/*! \file
+formats de sommets compacts : les attributs d'un sommet sont entrelaces dans un seul buffer, position, texcoord, normale, couleur, 
+chaque attribut est encode (float, half float, entiers normalises) selon un VertexFormat connu a la compilation.
+
+la taille d'un sommet et la position de chaque attribut sont des constantes :
+\code
+constexpr VertexFormat format= { VERTEX_FLOAT, VERTEX_HALF, VERTEX_SNORM10, VERTEX_UNORM8 };
+static_assert(format.stride() == 24, "");
+\endcode
+
+utilisation avec Mesh, cf Mesh::vertex_format() :
+\code
+Mesh mesh= read_mesh("data/bigguy.obj");
+mesh.vertex_format(VERTEX_FORMAT_QUANTIZED);
+\endcode
+*/
+
+//! representation d'un attribut dans le vertex buffer.
+enum VertexEncoding
+{
+    VERTEX_NONE= 0,     //!< pas d'attribut.
+    VERTEX_FLOAT,       //!< GL_FLOAT, 4 octets par composante.
+    VERTEX_HALF,        //!< GL_HALF_FLOAT, 2 octets par composante.
+    VERTEX_SNORM16,     //!< GL_SHORT normalise, 2 octets par composante. positions quantifiees dans la boite englobante de l'objet, cf USE_QUANTIZED_POSITION dans data/mesh.glsl.
+    VERTEX_SNORM10,     //!< GL_INT_2_10_10_10_REV normalise, 4 octets pour 3 composantes. normales.
+    VERTEX_UNORM8       //!< GL_UNSIGNED_BYTE normalise, 1 octet par composante. couleurs.
+};
+
+//! renvoie la taille en octets d'un attribut de n composantes, arrondie a un multiple de 4 octets.
+constexpr int vertex_encoding_size( const VertexEncoding encoding, const int n )
+{
+    return encoding == VERTEX_FLOAT ? 4*n
+        : (encoding == VERTEX_HALF || encoding == VERTEX_SNORM16) ? (2*n + 3) & ~3
+        : (encoding == VERTEX_SNORM10 || encoding == VERTEX_UNORM8) ? 4
+        : 0;
+}
+
+//! format d'un sommet : encodage de chaque attribut. les attributs sont entrelaces dans cet ordre.
+struct VertexFormat
+{
+    VertexEncoding position;    //!< 3 composantes.
+    VertexEncoding texcoord;    //!< 2 composantes.
+    VertexEncoding normal;      //!< 3 composantes.
+    VertexEncoding color;       //!< 4 composantes.
+    
+    constexpr int position_offset( ) const { return 0; }
+    constexpr int texcoord_offset( ) const { return position_offset() + vertex_encoding_size(position, 3); }
+    constexpr int normal_offset( ) const { return texcoord_offset() + vertex_encoding_size(texcoord, 2); }
+    constexpr int color_offset( ) const { return normal_offset() + vertex_encoding_size(normal, 3); }
+    //! taille d'un sommet, en octets.
+    constexpr int stride( ) const { return color_offset() + vertex_encoding_size(color, 4); }
+    
+    bool operator== ( const VertexFormat& f ) const { return position == f.position && texcoord == f.texcoord && normal == f.normal && color == f.color; }
+};
+
+//! format d'origine de Mesh, tous les attributs en float : 48 octets par sommet.
+constexpr VertexFormat VERTEX_FORMAT_FLOAT= { VERTEX_FLOAT, VERTEX_FLOAT, VERTEX_FLOAT, VERTEX_FLOAT };
+//! format par defaut de Mesh : position float, texcoord half float, normale 10 bits, couleur 8 bits : 24 octets par sommet.
+constexpr VertexFormat VERTEX_FORMAT_COMPACT= { VERTEX_FLOAT, VERTEX_HALF, VERTEX_SNORM10, VERTEX_UNORM8 };
+//! format compact et positions quantifiees sur 16 bits dans la boite englobante : 20 octets par sommet. pour les gros objets, les terrains.
+constexpr VertexFormat VERTEX_FORMAT_QUANTIZED= { VERTEX_SNORM16, VERTEX_HALF, VERTEX_SNORM10, VERTEX_UNORM8 };
+
+static_assert(VERTEX_FORMAT_FLOAT.stride() == 48, "vertex format");
+static_assert(VERTEX_FORMAT_COMPACT.stride() == 24, "vertex format");
+static_assert(VERTEX_FORMAT_QUANTIZED.stride() == 20, "vertex format");
+
+//! renvoie le format sans les attributs absents.
+VertexFormat vertex_format_used( const VertexFormat& format, const bool use_texcoord, const bool use_normal, const bool use_color );
+
+//! renvoie les definitions a ajouter au shader, cf read_program( ) et data/mesh.glsl.
+std::string vertex_format_definitions( const VertexFormat& format );
+
+/*! encode les sommets dans un buffer entrelace. les attributs VERTEX_NONE du format ne sont pas encodes.
+    positions VERTEX_SNORM16 : renvoie aussi scale et offset, la position est offset + scale * q, cf les uniforms position_scale et position_offset de data/mesh.glsl.
+ */
+void vertex_encode( const VertexFormat& format, 
+    const std::vector<vec3>& positions, const std::vector<vec2>& texcoords, const std::vector<vec3>& normals, const std::vector<vec4>& colors,
+    std::vector<unsigned char>& buffer, vec3& scale, vec3& offset );
+
+//! configure les attributs 0 position, 1 texcoord, 2 normale, 3 couleur du vertex array object selectionne, pour le buffer selectionne sur GL_ARRAY_BUFFER.
+void vertex_format_attributes( const VertexFormat& format );
+
+///@}
+#endif
@@ -1,9 +1,18 @@
 
 #include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cfloat>
 #include <ctype.h>
 #include <climits>
+#include <algorithm>
+#include <thread>
+
+#include <sys/stat.h>
 
 #include "wavefront.h"
+#include "mapped_file.h"
 
 /*! renvoie le chemin d'acces a un fichier. le chemin est toujours termine par /
     pathname("path/to/file") == "path/to/"
@@ -37,134 +46,559 @@ struct MaterialLib
 MaterialLib read_materials( const char *filename );
 
 
-Mesh read_mesh( const char *filename )
+// lecture des nombres, meme resultat que sscanf, sans copier la ligne.
+static inline
+bool is_blank( const char c )
 {
-    FILE *in= fopen(filename, "rt");
-    if(in == NULL)
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline
+const char *skip_blanks( const char *s, const char *end )
+{
+    while(s < end && is_blank(*s))
+        s++;
+    return s;
+}
+
+static inline
+bool is_digit( const char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+// %d
+static inline
+const char *parse_int( const char *s, const char *end, int& value )
+{
+    s= skip_blanks(s, end);
+    bool negative= false;
+    if(s < end && (*s == '-' || *s == '+'))
     {
-        printf("[error] loading mesh '%s'...\n", filename);
-        return Mesh::error();
+        negative= (*s == '-');
+        s++;
     }
     
-    Mesh data(GL_TRIANGLES);
+    if(s == end || !is_digit(*s))
+        return NULL;
     
-    printf("loading mesh '%s'...\n", filename);
+    int v= 0;
+    for(; s < end && is_digit(*s); s++)
+        v= v * 10 + (*s - '0');
+    
+    value= negative ? -v : v;
+    return s;
+}
+
+// %f : mantisse entiere * puissance de 10, exacte en double, sinon strtof.
+static
+const char *parse_float_slow( const char *s, const char *end, float& value )
+{
+    char tmp[128];
+    size_t n= 0;
+    while(s + n < end && n +1 < sizeof(tmp) && !isspace(s[n]))
+    {
+        tmp[n]= s[n];
+        n++;
+    }
+    tmp[n]= 0;
+    
+    char *last= NULL;
+    value= strtof(tmp, &last);
+    if(last == tmp)
+        return NULL;
+    return s + (last - tmp);
+}
+
+static inline
+const char *parse_float( const char *s, const char *end, float& value )
+{
+    static const double powers[]= { 
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    
+    s= skip_blanks(s, end);
+    const char *start= s;
+    
+    bool negative= false;
+    if(s < end && (*s == '-' || *s == '+'))
+    {
+        negative= (*s == '-');
+        s++;
+    }
+    
+    uint64_t mantissa= 0;
+    int digits= 0;
+    int exponent= 0;
+    bool valid= false;
+    for(; s < end && is_digit(*s); s++, valid= true)
+    {
+        if(mantissa == 0 && *s == '0') continue;        // zeros en tete
+        mantissa= mantissa * 10 + (*s - '0');
+        digits++;
+    }
+    if(s < end && *s == '.')
+    {
+        for(s++; s < end && is_digit(*s); s++, valid= true)
+        {
+            if(mantissa == 0 && *s == '0') { exponent--; continue; }
+            mantissa= mantissa * 10 + (*s - '0');
+            digits++;
+            exponent--;
+        }
+    }
+    // inf, nan, hexa...
+    if(!valid)
+        return parse_float_slow(start, end, value);
+    
+    if(s < end && (*s == 'e' || *s == 'E'))
+    {
+        // pas d'espace apres e, sinon l'exposant n'est pas lu
+        const char *e= s +1;
+        bool negative_exponent= false;
+        if(e < end && (*e == '-' || *e == '+'))
+        {
+            negative_exponent= (*e == '-');
+            e++;
+        }
+        if(e < end && is_digit(*e))
+        {
+            int v= 0;
+            for(; e < end && is_digit(*e); e++)
+                if(v < 10000) v= v * 10 + (*e - '0');
+            exponent+= negative_exponent ? -v : v;
+            s= e;
+        }
+    }
+    
+    if(digits > 15 || exponent < -22 || exponent > 22)
+        return parse_float_slow(start, end, value);
+    
+    double d= (double) mantissa;
+    if(exponent < 0)
+        d= d / powers[-exponent];
+    else
+        d= d * powers[exponent];
+    
+    if(d != 0)
+    {
+        // double arrondi : si le resultat en double tombe au milieu de 2 floats, il faut la valeur exacte...
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        if((bits & ((uint64_t(1) << 29) -1)) == (uint64_t(1) << 28) || d < FLT_MIN)
+            return parse_float_slow(start, end, value);
+    }
+    
+    value= negative ? (float) -d : (float) d;
+    return s;
+}
+
+static inline
+const char *parse_literal( const char *s, const char *end, const char *literal )
+{
+    for(; *literal; literal++, s++)
+        if(s == end || *s != *literal)
+            return NULL;
+    return s;
+}
+
+// %[^\r\n]
+static
+bool parse_name( const char *s, const char *end, std::string& name )
+{
+    while(s < end && isspace(*s) && *s != '\n')
+        s++;
+    const char *last= s;
+    while(last < end && *last != '\r' && *last != '\n')
+        last++;
+    if(last == s)
+        return false;
+    
+    name.assign(s, last);
+    return true;
+}
+
+
+// indice d'un attribut de sommet, dans un morceau du fichier.
+// les indices negatifs comptent a partir de la fin du tableau, ils ne seront connus qu'une fois tous les morceaux lus.
+enum
+{
+    INDEX_NONE= INT_MIN,
+    RELATIVE_P= 1,
+    RELATIVE_T= 2,
+    RELATIVE_N= 4
+};
+
+struct FaceVertex
+{
+    int p, t, n;
+    unsigned int relative;
+};
+
+struct ObjEvent
+{
+    unsigned int triangle;      // avant le triangle
+    bool library;               // mtllib ou usemtl
+    std::string name;
+};
+
+// un morceau du fichier, decoupe sur une fin de ligne, lu par un thread
+struct ObjChunk
+{
+    const char *begin;
+    const char *end;
     
     std::vector<vec3> positions;
     std::vector<vec2> texcoords;
     std::vector<vec3> normals;
-    MaterialLib materials;
-    int default_material_id= -1;
+    std::vector<FaceVertex> triangles;  // 3 sommets par triangle
+    std::vector<ObjEvent> events;
     
-    std::vector<int> idp;
-    std::vector<int> idt;
-    std::vector<int> idn;
+    const char *error;                  // ligne mal formee, ou NULL
     
-    char tmp[1024];
-    char line_buffer[1024];
-    bool error= true;
-    for(;;)
+    // premier element du morceau dans les tableaux du mesh
+    unsigned int position_base, texcoord_base, normal_base, vertex_base;
+    unsigned int missing_texcoords, missing_normals;
+};
+
+static
+const char *parse_face_vertex( const char *s, const char *end, int& p, int& t, int& n )
+{
+    // meme ordre que sscanf " %d/%d/%d %n", " %d/%d %n", " %d//%d %n", " %d %n"
+    const char *next;
+    p= 0; t= 0; n= 0;
+    if((next= parse_int(s, end, p)) == NULL)
+        return NULL;
+    
+    if(next < end && *next == '/')
     {
-        // charge une ligne du fichier
-        if(fgets(line_buffer, sizeof(line_buffer), in) == NULL)
+        const char *tnext= parse_int(next +1, end, t);
+        if(tnext != NULL)
         {
-            error= false;       // fin du fichier, pas d'erreur detectee
-            break;
+            const char *nnext= (tnext < end && *tnext == '/') ? parse_int(tnext +1, end, n) : NULL;
+            next= (nnext != NULL) ? nnext : tnext;
         }
-        
-        // force la fin de la ligne, au cas ou
-        line_buffer[sizeof(line_buffer) -1]= 0;
+        else if(next +1 < end && next[1] == '/')
+        {
+            t= 0;
+            const char *nnext= parse_int(next +2, end, n);
+            if(nnext != NULL)
+                next= nnext;
+        }
+    }
+    return skip_blanks(next, end);
+}
+
+static
+void parse_chunk( ObjChunk& chunk )
+{
+    std::vector<int> idp, idt, idn;
+    
+    const char *end= chunk.end;
+    const char *next_line= chunk.begin;
+    while(next_line < end)
+    {
+        const char *line= next_line;
+        const char *eol= (const char *) memchr(line, '\n', end - line);
+        next_line= (eol != NULL) ? eol +1 : end;
         
         // saute les espaces en debut de ligne
-        char *line= line_buffer;
-        while(*line && isspace(*line))
-            line++;
+        const char *s= line;
+        while(s < next_line && isspace(*s) && *s != '\n')
+            s++;
+        if(s == next_line)
+            continue;
         
-        if(line[0] == 'v')
+        bool valid= true;
+        if(s[0] == 'v' && s +1 < next_line)
         {
             float x, y, z;
-            if(line[1] == ' ')          // position x y z
+            const char *f;
+            if(s[1] == ' ')          // position x y z
             {
-                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
-                    break;
-                positions.push_back( vec3(x, y, z) );
+                valid= (f= parse_float(s +1, next_line, x)) && (f= parse_float(f, next_line, y)) && (f= parse_float(f, next_line, z));
+                if(valid) chunk.positions.push_back( vec3(x, y, z) );
             }
-            else if(line[1] == 'n')     // normal x y z
+            else if(s[1] == 'n')     // normal x y z
             {
-                if(sscanf(line, "vn %f %f %f", &x, &y, &z) != 3)
-                    break;
-                normals.push_back( vec3(x, y, z) );
+                valid= (f= parse_float(s +2, next_line, x)) && (f= parse_float(f, next_line, y)) && (f= parse_float(f, next_line, z));
+                if(valid) chunk.normals.push_back( vec3(x, y, z) );
             }
-            else if(line[1] == 't')     // texcoord x y
+            else if(s[1] == 't')     // texcoord x y
             {
-                if(sscanf(line, "vt %f %f", &x, &y) != 2)
-                    break;
-                texcoords.push_back( vec2(x, y) );
+                valid= (f= parse_float(s +2, next_line, x)) && (f= parse_float(f, next_line, y));
+                if(valid) chunk.texcoords.push_back( vec2(x, y) );
             }
         }
         
-        else if(line[0] == 'f')         // triangle a b c, les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
+        else if(s[0] == 'f')         // triangle a b c, les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
         {
             idp.clear();
             idt.clear();
             idn.clear();
             
-            int next;
-            for(line= line +1; ; line= line + next)
+            int p, t, n;
+            for(const char *f= s +1; (f= parse_face_vertex(f, next_line, p, t, n)) != NULL; )
             {
-                idp.push_back(0); 
-                idt.push_back(0); 
-                idn.push_back(0);         // 0: invalid index
-                
-                next= 0;
-                if(sscanf(line, " %d/%d/%d %n", &idp.back(), &idt.back(), &idn.back(), &next) == 3) 
-                    continue;
-                else if(sscanf(line, " %d/%d %n", &idp.back(), &idt.back(), &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d//%d %n", &idp.back(), &idn.back(), &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d %n", &idp.back(), &next) == 1)
-                    continue;
-                else if(next == 0)      // fin de ligne
-                    break;
+                idp.push_back(p);
+                idt.push_back(t);
+                idn.push_back(n);
             }
             
-            for(int v= 2; v +1 < (int) idp.size(); v++)
+            // indices relatifs au morceau, pour les indices negatifs
+            int np= (int) chunk.positions.size();
+            int nt= (int) chunk.texcoords.size();
+            int nn= (int) chunk.normals.size();
+            for(int v= 2; v < (int) idp.size(); v++)
             {
                 int idv[3]= { 0, v -1, v };
                 for(int i= 0; i < 3; i++)
                 {
                     int k= idv[i];
-                    int p= (idp[k] < 0) ? (int) positions.size() + idp[k] : idp[k] -1;
-                    int t= (idt[k] < 0) ? (int) texcoords.size() + idt[k] : idt[k] -1;
-                    int n= (idn[k] < 0) ? (int) normals.size()   + idn[k] : idn[k] -1;
+                    FaceVertex vertex;
+                    vertex.relative= 0;
                     
-                    if(p < 0) break; // error
-                    if(t >= 0) data.texcoord(texcoords[t]);
-                    if(n >= 0) data.normal(normals[n]);
-                    data.vertex(positions[p]);
+                    if(idp[k] < 0) { vertex.p= np + idp[k]; vertex.relative|= RELATIVE_P; }
+                    else vertex.p= (idp[k] > 0) ? idp[k] -1 : INDEX_NONE;
+                    if(idt[k] < 0) { vertex.t= nt + idt[k]; vertex.relative|= RELATIVE_T; }
+                    else vertex.t= (idt[k] > 0) ? idt[k] -1 : INDEX_NONE;
+                    if(idn[k] < 0) { vertex.n= nn + idn[k]; vertex.relative|= RELATIVE_N; }
+                    else vertex.n= (idn[k] > 0) ? idn[k] -1 : INDEX_NONE;
+                    
+                    chunk.triangles.push_back(vertex);
                 }
             }
         }
         
-        else if(line[0] == 'm')
+        else if(s[0] == 'm' || s[0] == 'u')
+        {
+            const char *f= parse_literal(s, next_line, s[0] == 'm' ? "mtllib" : "usemtl");
+            ObjEvent event;
+            if(f != NULL && parse_name(f, next_line, event.name))
+            {
+                event.triangle= (unsigned int) chunk.triangles.size() / 3;
+                event.library= (s[0] == 'm');
+                chunk.events.push_back(event);
+            }
+        }
+        
+        if(!valid)
+        {
+            chunk.error= line;
+            chunk.end= line;
+            break;
+        }
+    }
+}
+
+// indices dans les tableaux complets du mesh, -1 si l'attribut n'est pas defini
+static inline
+int resolve( const int index, const bool relative, const unsigned int base, const unsigned int count )
+{
+    if(index == INDEX_NONE)
+        return -1;
+    
+    long long i= relative ? (long long) base + index : (long long) index;
+    if(i < 0 || i >= (long long) count)
+        return -1;
+    return (int) i;
+}
+
+static
+void fill_chunk( ObjChunk& chunk, const std::vector<vec3>& positions, const std::vector<vec2>& texcoords, const std::vector<vec3>& normals,
+    std::vector<vec3>& mesh_positions, std::vector<vec2>& mesh_texcoords, std::vector<vec3>& mesh_normals )
+{
+    chunk.missing_texcoords= 0;
+    chunk.missing_normals= 0;
+    for(unsigned int i= 0; i < (unsigned int) chunk.triangles.size(); i++)
+    {
+        const FaceVertex& v= chunk.triangles[i];
+        unsigned int id= chunk.vertex_base + i;
+        
+        int p= resolve(v.p, v.relative & RELATIVE_P, chunk.position_base, (unsigned int) positions.size());
+        mesh_positions[id]= (p < 0) ? vec3() : positions[p];
+        
+        int t= resolve(v.t, v.relative & RELATIVE_T, chunk.texcoord_base, (unsigned int) texcoords.size());
+        if(t < 0) chunk.missing_texcoords++;
+        else if(!mesh_texcoords.empty()) mesh_texcoords[id]= texcoords[t];
+        
+        int n= resolve(v.n, v.relative & RELATIVE_N, chunk.normal_base, (unsigned int) normals.size());
+        if(n < 0) chunk.missing_normals++;
+        else if(!mesh_normals.empty()) mesh_normals[id]= normals[n];
+    }
+}
+
+// sommets sans attribut : Mesh::vertex( ) recopie le dernier attribut, s'il existe.
+template < typename T >
+static
+void fill_missing( const std::vector<ObjChunk>& chunks, const std::vector<T>& attributes, const unsigned int attribute, std::vector<T>& mesh_attributes )
+{
+    std::vector<T> tmp;
+    tmp.reserve(mesh_attributes.size());
+    for(unsigned int c= 0; c < (unsigned int) chunks.size(); c++)
+    {
+        const ObjChunk& chunk= chunks[c];
+        unsigned int base= (attribute == RELATIVE_T) ? chunk.texcoord_base : chunk.normal_base;
+        for(unsigned int i= 0; i < (unsigned int) chunk.triangles.size(); i++)
+        {
+            const FaceVertex& v= chunk.triangles[i];
+            int k= resolve((attribute == RELATIVE_T) ? v.t : v.n, v.relative & attribute, base, (unsigned int) attributes.size());
+            unsigned int id= chunk.vertex_base + i;
+            if(k >= 0)
+                tmp.push_back(mesh_attributes[id]);
+            if(!tmp.empty() && tmp.size() != id +1)
+                tmp.push_back(tmp.back());
+        }
+    }
+    mesh_attributes.swap(tmp);
+}
+
+
+// lit le fichier .obj, renvoie les fichiers .mtl utilises et les erreurs.
+static
+Mesh read_obj( const char *filename, std::vector<std::string>& dependencies, bool& parse_error )
+{
+    MappedFile file;
+    if(!file.open(filename))
+    {
+        printf("[error] loading mesh '%s'...\n", filename);
+        parse_error= true;
+        return Mesh::error();
+    }
+    
+    Mesh data(GL_TRIANGLES);
+    
+    printf("loading mesh '%s'...\n", filename);
+    
+    // decoupe le fichier en morceaux, sur une fin de ligne, 1 par thread, au moins 1Mo par morceau
+    unsigned int threads= std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk_size= std::max(file.size / threads, size_t(1) << 20);
+    
+    std::vector<ObjChunk> chunks;
+    const char *end= file.data + file.size;
+    for(const char *begin= file.data; begin < end; )
+    {
+        const char *last= (size_t(end - begin) > chunk_size) ? begin + chunk_size : end;
+        if(last < end)
         {
-           if(sscanf(line, "mtllib %[^\r\n]", tmp) == 1)
-           {
-               materials= read_materials( std::string(pathname(filename) + tmp).c_str() );
-               // enregistre les matieres dans le mesh
-               data.mesh_materials(materials.data);
-           }
+            const char *eol= (const char *) memchr(last, '\n', end - last);
+            last= (eol != NULL) ? eol +1 : end;
         }
         
-        else if(line[0] == 'u')
+        chunks.push_back( ObjChunk() );
+        chunks.back().begin= begin;
+        chunks.back().end= last;
+        chunks.back().error= NULL;
+        begin= last;
+    }
+    
+    // lit les morceaux en parallele
+    {
+        std::vector<std::thread> workers;
+        for(unsigned int i= 1; i < (unsigned int) chunks.size(); i++)
+            workers.push_back( std::thread(parse_chunk, std::ref(chunks[i])) );
+        if(chunks.size() > 0)
+            parse_chunk(chunks[0]);
+        for(unsigned int i= 0; i < (unsigned int) workers.size(); i++)
+            workers[i].join();
+    }
+    
+    // ignore les morceaux apres une erreur, comme la lecture ligne par ligne
+    const char *error= NULL;
+    for(unsigned int i= 0; i < (unsigned int) chunks.size(); i++)
+        if(chunks[i].error != NULL)
         {
-           if(sscanf(line, "usemtl %[^\r\n]", tmp) == 1)
-           {
-               int id= -1;
-               for(unsigned int i= 0; i < (unsigned int) materials.names.size(); i++)
-                if(materials.names[i] == tmp)
-                        id= i;
+            error= chunks[i].error;
+            chunks.resize(i +1);
+            break;
+        }
+    
+    // place des morceaux dans les tableaux complets
+    unsigned int np= 0, nt= 0, nn= 0, nv= 0;
+    for(unsigned int i= 0; i < (unsigned int) chunks.size(); i++)
+    {
+        ObjChunk& chunk= chunks[i];
+        chunk.position_base= np;
+        chunk.texcoord_base= nt;
+        chunk.normal_base= nn;
+        chunk.vertex_base= nv;
+        np+= (unsigned int) chunk.positions.size();
+        nt+= (unsigned int) chunk.texcoords.size();
+        nn+= (unsigned int) chunk.normals.size();
+        nv+= (unsigned int) chunk.triangles.size();
+    }
+    
+    std::vector<vec3> positions;
+    std::vector<vec2> texcoords;
+    std::vector<vec3> normals;
+    positions.reserve(np);
+    texcoords.reserve(nt);
+    normals.reserve(nn);
+    for(unsigned int i= 0; i < (unsigned int) chunks.size(); i++)
+    {
+        ObjChunk& chunk= chunks[i];
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        std::vector<vec3>().swap(chunk.positions);
+        std::vector<vec2>().swap(chunk.texcoords);
+        std::vector<vec3>().swap(chunk.normals);
+    }
+    
+    // construit les sommets des triangles en parallele
+    std::vector<vec3> mesh_positions(nv);
+    std::vector<vec2> mesh_texcoords(nt > 0 ? nv : 0);
+    std::vector<vec3> mesh_normals(nn > 0 ? nv : 0);
+    {
+        std::vector<std::thread> workers;
+        for(unsigned int i= 1; i < (unsigned int) chunks.size(); i++)
+            workers.push_back( std::thread(fill_chunk, std::ref(chunks[i]), std::cref(positions), std::cref(texcoords), std::cref(normals), 
+                std::ref(mesh_positions), std::ref(mesh_texcoords), std::ref(mesh_normals)) );
+        if(chunks.size() > 0)
+            fill_chunk(chunks[0], positions, texcoords, normals, mesh_positions, mesh_texcoords, mesh_normals);
+        for(unsigned int i= 0; i < (unsigned int) workers.size(); i++)
+            workers[i].join();
+    }
+    
+    unsigned int missing_texcoords= 0, missing_normals= 0;
+    for(unsigned int i= 0; i < (unsigned int) chunks.size(); i++)
+    {
+        missing_texcoords+= chunks[i].missing_texcoords;
+        missing_normals+= chunks[i].missing_normals;
+    }
+    if(missing_texcoords == nv) mesh_texcoords.clear();
+    else if(missing_texcoords > 0) fill_missing(chunks, texcoords, RELATIVE_T, mesh_texcoords);
+    if(missing_normals == nv) mesh_normals.clear();
+    else if(missing_normals > 0) fill_missing(chunks, normals, RELATIVE_N, mesh_normals);
+    
+    // matieres, dans l'ordre du fichier
+    MaterialLib materials;
+    int default_material_id= -1;
+    std::vector<unsigned int> triangle_materials;
+    unsigned int vertices= 0;
+    for(unsigned int c= 0; c < (unsigned int) chunks.size(); c++)
+    {
+        const ObjChunk& chunk= chunks[c];
+        unsigned int count= (unsigned int) chunk.triangles.size() / 3;
+        unsigned int e= 0;
+        for(unsigned int i= 0; i <= count; i++)
+        {
+            for(; e < (unsigned int) chunk.events.size() && chunk.events[e].triangle == i; e++)
+            {
+                const ObjEvent& event= chunk.events[e];
+                if(event.library)
+                {
+                    dependencies.push_back(pathname(filename) + event.name);
+                    materials= read_materials( dependencies.back().c_str() );
+                    // enregistre les matieres dans le mesh
+                    data.mesh_materials(materials.data);
+                    continue;
+                }
+                
+                int id= -1;
+                for(unsigned int k= 0; k < (unsigned int) materials.names.size(); k++)
+                    if(materials.names[k] == event.name)
+                        id= k;
                 
                 if(id == -1)
                     id= default_material_id;
@@ -175,20 +609,302 @@ Mesh read_mesh( const char *filename )
                     default_material_id= data.mesh_material(Material());
                     id= default_material_id;
                 }
-                    // selectionne une matiere pour le prochain triangle
-                data.material(id);
-           }
+                // selectionne une matiere pour le prochain triangle
+                triangle_materials.push_back(id);
+            }
+            
+            if(i == count)
+                break;
+            
+            // meme chose que Mesh::vertex( ), recopie la derniere matiere
+            for(int k= 0; k < 3; k++)
+            {
+                vertices++;
+                if(triangle_materials.size() > 0 && vertices / 3 > triangle_materials.size())
+                    triangle_materials.push_back(triangle_materials.back());
+            }
         }
     }
     
-    fclose(in);
+    data.adopt_positions(std::move(mesh_positions));
+    data.adopt_texcoords(std::move(mesh_texcoords));
+    data.adopt_normals(std::move(mesh_normals));
+    data.adopt_materials(std::move(triangle_materials));
     
+    parse_error= (error != NULL);
     if(error)
-        printf("loading mesh '%s'...\n[error]\n%s\n\n", filename, line_buffer);
+    {
+        const char *eol= (const char *) memchr(error, '\n', end - error);
+        std::string line(error, (eol != NULL) ? eol +1 : end);
+        printf("loading mesh '%s'...\n[error]\n%s\n\n", filename, line.c_str());
+    }
     
     return data;
 }
 
+
+// cache binaire des mesh, a cote du fichier .obj
+// entete, puis les tableaux alignes sur 64 octets : positions, texcoords, normals, colors, indices, matieres, matieres des triangles et
+// fichiers sources (.obj et .mtl) avec leur taille et leur date, pour verifier que le cache est a jour.
+
+static const uint32_t mesh_cache_version= 1;
+static const uint32_t mesh_cache_byte_order= 0x01020304;
+static const size_t mesh_cache_alignment= 64;
+
+enum
+{
+    CACHE_POSITIONS= 0,
+    CACHE_TEXCOORDS,
+    CACHE_NORMALS,
+    CACHE_COLORS,
+    CACHE_INDICES,
+    CACHE_MATERIALS,
+    CACHE_TRIANGLE_MATERIALS,
+    CACHE_DEPENDENCIES,
+    CACHE_BLOBS
+};
+
+struct MeshCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t primitives;
+    uint32_t count[CACHE_BLOBS];
+    uint64_t offset[CACHE_BLOBS];
+    uint64_t size;
+};
+
+// 1 fichier source
+struct MeshCacheDependency
+{
+    uint64_t size;
+    int64_t time;
+    uint32_t length;        // longueur du nom, suit la structure
+    uint32_t pad;
+};
+
+static
+bool file_info( const char *filename, uint64_t& size, int64_t& time )
+{
+    struct stat info;
+    if(stat(filename, &info) < 0)
+        return false;
+    
+    size= (uint64_t) info.st_size;
+    time= (int64_t) info.st_mtime;
+    return true;
+}
+
+static
+std::string mesh_cache_filename( const char *filename )
+{
+    return std::string(filename).append(".gkmesh");
+}
+
+// charge le cache, s'il existe et s'il est a jour.
+static
+bool read_mesh_cache( const char *filename, Mesh& mesh )
+{
+    MappedFile file;
+    if(!file.open(filename))
+        return false;
+    
+    MeshCacheHeader header;
+    if(file.size < sizeof(header))
+        return false;
+    memcpy(&header, file.data, sizeof(header));
+    
+    if(strncmp(header.magic, "gkmesh", sizeof(header.magic)) != 0 || header.version != mesh_cache_version 
+    || header.byte_order != mesh_cache_byte_order || header.size != file.size)
+    {
+        printf("[error] mesh cache '%s': wrong version...\n", filename);
+        return false;
+    }
+    
+    // verifie la taille des tableaux
+    const size_t sizes[CACHE_BLOBS]= { sizeof(vec3), sizeof(vec2), sizeof(vec3), sizeof(vec4), sizeof(unsigned int), 13 * sizeof(float), sizeof(unsigned int), 1 };
+    for(int i= 0; i < CACHE_BLOBS; i++)
+        if(header.offset[i] % mesh_cache_alignment || header.offset[i] > file.size || uint64_t(header.count[i]) * sizes[i] > file.size - header.offset[i])
+        {
+            printf("[error] mesh cache '%s': corrupted...\n", filename);
+            return false;
+        }
+    
+    // verifie que les fichiers sources n'ont pas change
+    const char *dependencies= file.data + header.offset[CACHE_DEPENDENCIES];
+    const char *end= dependencies + header.count[CACHE_DEPENDENCIES];
+    while(dependencies < end)
+    {
+        MeshCacheDependency dependency;
+        if(size_t(end - dependencies) < sizeof(dependency))
+            return false;
+        memcpy(&dependency, dependencies, sizeof(dependency));
+        dependencies+= sizeof(dependency);
+        if(size_t(end - dependencies) < dependency.length)
+            return false;
+        
+        std::string name(dependencies, dependency.length);
+        dependencies+= dependency.length;
+        
+        uint64_t size;
+        int64_t time;
+        if(!file_info(name.c_str(), size, time) || size != dependency.size || time != dependency.time)
+            return false;       // cache perime, pas une erreur
+    }
+    
+    printf("loading mesh cache '%s'...\n", filename);
+    
+    // une seule copie par tableau, pas de conversion
+    mesh= Mesh(header.primitives);
+    const vec3 *positions= (const vec3 *) (file.data + header.offset[CACHE_POSITIONS]);
+    const vec2 *texcoords= (const vec2 *) (file.data + header.offset[CACHE_TEXCOORDS]);
+    const vec3 *normals= (const vec3 *) (file.data + header.offset[CACHE_NORMALS]);
+    const vec4 *colors= (const vec4 *) (file.data + header.offset[CACHE_COLORS]);
+    const unsigned int *indices= (const unsigned int *) (file.data + header.offset[CACHE_INDICES]);
+    const unsigned int *triangle_materials= (const unsigned int *) (file.data + header.offset[CACHE_TRIANGLE_MATERIALS]);
+    mesh.adopt_positions(std::vector<vec3>(positions, positions + header.count[CACHE_POSITIONS]));
+    mesh.adopt_texcoords(std::vector<vec2>(texcoords, texcoords + header.count[CACHE_TEXCOORDS]));
+    mesh.adopt_normals(std::vector<vec3>(normals, normals + header.count[CACHE_NORMALS]));
+    mesh.adopt_colors(std::vector<vec4>(colors, colors + header.count[CACHE_COLORS]));
+    mesh.adopt_indices(std::vector<unsigned int>(indices, indices + header.count[CACHE_INDICES]));
+    mesh.adopt_materials(std::vector<unsigned int>(triangle_materials, triangle_materials + header.count[CACHE_TRIANGLE_MATERIALS]));
+    
+    const float *m= (const float *) (file.data + header.offset[CACHE_MATERIALS]);
+    std::vector<Material> materials(header.count[CACHE_MATERIALS]);
+    for(unsigned int i= 0; i < (unsigned int) materials.size(); i++, m+= 13)
+    {
+        materials[i].diffuse= Color(m[0], m[1], m[2], m[3]);
+        materials[i].specular= Color(m[4], m[5], m[6], m[7]);
+        materials[i].emission= Color(m[8], m[9], m[10], m[11]);
+        materials[i].ns= m[12];
+    }
+    mesh.mesh_materials(materials);
+    
+    return true;
+}
+
+// ecrit un tableau, aligne
+static
+void write_blob( FILE *out, const void *data, const size_t size, uint64_t& offset )
+{
+    static const char zeros[mesh_cache_alignment]= { 0 };
+    
+    long position= ftell(out);
+    size_t pad= (mesh_cache_alignment - position % mesh_cache_alignment) % mesh_cache_alignment;
+    fwrite(zeros, 1, pad, out);
+    
+    offset= (uint64_t) position + pad;
+    if(size > 0)
+        fwrite(data, 1, size, out);
+}
+
+static
+int write_mesh_cache( const Mesh& mesh, const char *filename, const std::vector<std::string>& dependencies )
+{
+    // ecrit un fichier temporaire, puis le renomme : pas de cache incomplet si plusieurs applications chargent le meme fichier
+    std::string tmp= std::string(filename).append(".tmp");
+    FILE *out= fopen(tmp.c_str(), "wb");
+    if(out == NULL)
+        return -1;
+    
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, "gkmesh");
+    header.version= mesh_cache_version;
+    header.byte_order= mesh_cache_byte_order;
+    header.primitives= mesh.primitives();
+    header.count[CACHE_POSITIONS]= (uint32_t) mesh.positions().size();
+    header.count[CACHE_TEXCOORDS]= (uint32_t) mesh.texcoords().size();
+    header.count[CACHE_NORMALS]= (uint32_t) mesh.normals().size();
+    header.count[CACHE_COLORS]= (uint32_t) mesh.colors().size();
+    header.count[CACHE_INDICES]= (uint32_t) mesh.indices().size();
+    header.count[CACHE_MATERIALS]= (uint32_t) mesh.mesh_materials().size();
+    header.count[CACHE_TRIANGLE_MATERIALS]= (uint32_t) mesh.materials().size();
+    fwrite(&header, sizeof(header), 1, out);
+    
+    write_blob(out, mesh.positions().data(), mesh.positions().size() * sizeof(vec3), header.offset[CACHE_POSITIONS]);
+    write_blob(out, mesh.texcoords().data(), mesh.texcoords().size() * sizeof(vec2), header.offset[CACHE_TEXCOORDS]);
+    write_blob(out, mesh.normals().data(), mesh.normals().size() * sizeof(vec3), header.offset[CACHE_NORMALS]);
+    write_blob(out, mesh.colors().data(), mesh.colors().size() * sizeof(vec4), header.offset[CACHE_COLORS]);
+    write_blob(out, mesh.indices().data(), mesh.indices().size() * sizeof(unsigned int), header.offset[CACHE_INDICES]);
+    
+    std::vector<float> materials;
+    for(unsigned int i= 0; i < (unsigned int) mesh.mesh_materials().size(); i++)
+    {
+        const Material& m= mesh.mesh_materials()[i];
+        const float data[13]= { 
+            m.diffuse.r, m.diffuse.g, m.diffuse.b, m.diffuse.a,
+            m.specular.r, m.specular.g, m.specular.b, m.specular.a,
+            m.emission.r, m.emission.g, m.emission.b, m.emission.a,
+            m.ns };
+        materials.insert(materials.end(), data, data + 13);
+    }
+    write_blob(out, materials.data(), materials.size() * sizeof(float), header.offset[CACHE_MATERIALS]);
+    write_blob(out, mesh.materials().data(), mesh.materials().size() * sizeof(unsigned int), header.offset[CACHE_TRIANGLE_MATERIALS]);
+    
+    std::vector<char> files;
+    for(unsigned int i= 0; i < (unsigned int) dependencies.size(); i++)
+    {
+        MeshCacheDependency dependency;
+        memset(&dependency, 0, sizeof(dependency));
+        if(!file_info(dependencies[i].c_str(), dependency.size, dependency.time))
+        {
+            fclose(out);
+            remove(tmp.c_str());
+            return -1;
+        }
+        
+        dependency.length= (uint32_t) dependencies[i].size();
+        files.insert(files.end(), (const char *) &dependency, (const char *) &dependency + sizeof(dependency));
+        files.insert(files.end(), dependencies[i].begin(), dependencies[i].end());
+    }
+    header.count[CACHE_DEPENDENCIES]= (uint32_t) files.size();
+    write_blob(out, files.data(), files.size(), header.offset[CACHE_DEPENDENCIES]);
+    
+    header.size= (uint64_t) ftell(out);
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    
+    bool error= (ferror(out) != 0);
+    if(fclose(out) != 0 || error)
+    {
+        remove(tmp.c_str());
+        return -1;
+    }
+    
+#ifdef WIN32
+    remove(filename);
+#endif
+    if(rename(tmp.c_str(), filename) != 0)
+    {
+        remove(tmp.c_str());
+        return -1;
+    }
+    
+    printf("writing mesh cache '%s'...\n", filename);
+    return 0;
+}
+
+
+Mesh read_mesh( const char *filename )
+{
+    std::string cache= mesh_cache_filename(filename);
+    Mesh mesh;
+    if(read_mesh_cache(cache.c_str(), mesh))
+        return mesh;
+    
+    std::vector<std::string> dependencies(1, filename);
+    bool parse_error= false;
+    mesh= read_obj(filename, dependencies, parse_error);
+    
+    // n'enregistre que les fichiers complets
+    if(!parse_error)
+        write_mesh_cache(mesh, cache.c_str(), dependencies);
+    
+    return mesh;
+}
+
 int write_mesh( const Mesh& mesh, const char *filename )
 {
     if(mesh == Mesh::error())
@@ -11,7 +11,12 @@
 //! \file 
 //! charge un fichier wavefront .obj et construit un mesh.
 
-//! charge un fichier wavefront .obj et renvoie un mesh compose de triangles non indexes. utiliser glDrawArrays pour l'afficher. a detruire avec Mesh::release( ).
+/*! charge un fichier wavefront .obj et renvoie un mesh compose de triangles non indexes. utiliser glDrawArrays pour l'afficher. a detruire avec Mesh::release( ).
+    le fichier est projete en memoire et lu en parallele, par morceaux, 1 par thread.
+    
+    le mesh est aussi enregistre dans un cache binaire, a cote du fichier (ex: data/bigguy.obj.gkmesh), relu directement au prochain chargement, 
+    tant que le fichier .obj et ses fichiers .mtl ne changent pas.
+ */
 Mesh read_mesh( const char *filename );
 
 //! enregistre un mesh dans un fichier .obj.
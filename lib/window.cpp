@@ -144,78 +144,104 @@ int run( Window window, int (*draw)() )
     return 0;
 }
 
+static void handle_event( Window window, const SDL_Event& event )
+{
+    switch(event.type)
+    {
+        case SDL_WINDOWEVENT:
+            // redimensionner la fenetre...
+            if(event.window.event == SDL_WINDOWEVENT_RESIZED)
+            {
+                // conserve les dimensions de la fenetre
+                width= event.window.data1;
+                height= event.window.data2;
+                SDL_SetWindowSize(window, width, height);
+
+                // ... et le viewport opengl
+                glViewport(0, 0, width, height);
+            }
+            break;
+
+        case SDL_DROPFILE:
+            last_drop.assign(event.drop.file);
+            SDL_free(event.drop.file);
+            break;
+
+        case SDL_TEXTINPUT:
+            // conserver le dernier caractere
+            last_text= event.text;
+            break;
+
+        case SDL_KEYDOWN:
+            // modifier l'etat du clavier
+            if((size_t) event.key.keysym.scancode < key_states.size())
+            {
+                key_states[event.key.keysym.scancode]= 1;
+                last_key= event.key;    // conserver le dernier evenement
+            }
+
+            // fermer l'application
+            if(event.key.keysym.sym == SDLK_ESCAPE)
+                stop= 1;
+            break;
+
+        case SDL_KEYUP:
+            // modifier l'etat du clavier
+            if((size_t) event.key.keysym.scancode < key_states.size())
+            {
+                key_states[event.key.keysym.scancode]= 0;
+                last_key= event.key;    // conserver le dernier evenement
+            }
+            break;
+
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            last_button= event.button;
+            break;
+
+        case SDL_MOUSEWHEEL:
+            last_wheel= event.wheel;
+            break;
+
+        case SDL_QUIT:
+            stop= 1;            // fermer l'application
+            break;
+    }
+}
+
 int events( Window window )
 {
     // gestion des evenements
     SDL_Event event;
     while(SDL_PollEvent(&event))
+        handle_event(window, event);
+
+    return 1 - stop;
+}
+
+int wait_events( Window window, const int timeout )
+{
+    // attend le premier evenement, puis traite les suivants
+    SDL_Event event;
+    if(SDL_WaitEventTimeout(&event, timeout))
     {
-        switch(event.type)
-        {
-            case SDL_WINDOWEVENT:
-                // redimensionner la fenetre...
-                if(event.window.event == SDL_WINDOWEVENT_RESIZED)
-                {
-                    // conserve les dimensions de la fenetre
-                    width= event.window.data1;
-                    height= event.window.data2;
-                    SDL_SetWindowSize(window, width, height);
-
-                    // ... et le viewport opengl
-                    glViewport(0, 0, width, height);
-                }
-                break;
-
-            case SDL_DROPFILE:
-                last_drop.assign(event.drop.file);
-                SDL_free(event.drop.file);
-                break;
-
-            case SDL_TEXTINPUT:
-                // conserver le dernier caractere
-                last_text= event.text;
-                break;
-
-            case SDL_KEYDOWN:
-                // modifier l'etat du clavier
-                if((size_t) event.key.keysym.scancode < key_states.size())
-                {
-                    key_states[event.key.keysym.scancode]= 1;
-                    last_key= event.key;    // conserver le dernier evenement
-                }
-
-                // fermer l'application
-                if(event.key.keysym.sym == SDLK_ESCAPE)
-                    stop= 1;
-                break;
-
-            case SDL_KEYUP:
-                // modifier l'etat du clavier
-                if((size_t) event.key.keysym.scancode < key_states.size())
-                {
-                    key_states[event.key.keysym.scancode]= 0;
-                    last_key= event.key;    // conserver le dernier evenement
-                }
-                break;
-
-            case SDL_MOUSEBUTTONDOWN:
-            case SDL_MOUSEBUTTONUP:
-                last_button= event.button;
-                break;
-
-            case SDL_MOUSEWHEEL:
-                last_wheel= event.wheel;
-                break;
-
-            case SDL_QUIT:
-                stop= 1;            // fermer l'application
-                break;
-        }
+        handle_event(window, event);
+        while(SDL_PollEvent(&event))
+            handle_event(window, event);
     }
 
     return 1 - stop;
 }
 
+void wake_events( )
+{
+    // SDL_PushEvent() peut etre utilise par les autres threads
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type= SDL_USEREVENT;
+    SDL_PushEvent(&event);
+}
+
 
 //! creation d'une fenetre pour l'application.
 Window create_window( const int w, const int h )
@@ -256,10 +282,33 @@ Window create_window( const int w, const int h )
 
 void release_window( Window window )
 {
+    if(window == NULL)
+        return;
+    
     SDL_StopTextInput();
     SDL_DestroyWindow(window);
 }
 
+//! application sans fenetre.
+int create_headless_window( const int w, const int h )
+{
+    // pas de video : uniquement le temps et les evenements
+    if(SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS) < 0)
+    {
+        printf("[error] SDL_Init() failed:\n%s\n", SDL_GetError());
+        return -1;
+    }
+    
+    atexit(SDL_Quit);
+    
+    // pas de clavier, toutes les touches sont relachees
+    key_states.assign(SDL_NUM_SCANCODES, 0);
+    
+    width= w;
+    height= h;
+    return 0;
+}
+
 
 #ifndef NO_GLEW
 #ifndef GK_RELEASE
@@ -309,15 +358,32 @@ Context create_context( Window window, const int major, const int minor )
 
     SDL_GL_SetSwapInterval(1);
 
+    if(init_extensions() < 0)
+    {
+        SDL_GL_DeleteContext(context);
+        return NULL;
+    }
+
+    return context;
+}
+
+//! charge les extensions et configure les messages de debug du contexte courant.
+int init_extensions( const bool headless )
+{
 #ifndef NO_GLEW
     // initialise les extensions opengl
     glewExperimental= 1;
     GLenum err= glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // glew des distributions est compile pour GLX : glewInit( ) charge les fonctions du contexte courant, puis echoue sur 
+    // les extensions GLX, sans serveur X. le contexte EGL n'en a pas besoin.
+    if(headless && err == GLEW_ERROR_NO_GLX_DISPLAY)
+        err= GLEW_OK;
+#endif
     if(err != GLEW_OK)
     {
         printf("[error] loading extensions\n%s\n", glewGetErrorString(err));
-        SDL_GL_DeleteContext(context);
-        return NULL;
+        return -1;
     }
 
     // purge les erreurs opengl generees par glew !
@@ -335,7 +401,7 @@ Context create_context( Window window, const int major, const int minor )
 #endif
 #endif
 
-    return context;
+    return 0;
 }
 
 void release_context( Context context )
@@ -19,6 +19,9 @@ Window create_window( const int width, const int height );
 //! destruction de la fenetre.
 void release_window( Window w );
 
+//! application sans fenetre, cf create_headless_context() : temps, evenements et dimensions de l'image, le clavier reste vide. renvoie -1 en cas d'erreur.
+int create_headless_window( const int width, const int height );
+
 typedef SDL_GLContext Context;
 
 //! cree et configure un contexte opengl.
@@ -26,6 +29,10 @@ Context create_context( Window window, const int major= 3, const int minor= 2 );
 //! detruit le contexte openGL.
 void release_context( Context context );
 
+//! fonction interne : charge les extensions (glew) et active les messages de debug du contexte courant. renvoie -1 en cas d'erreur.
+//! headless : contexte EGL, sans serveur X, cf create_headless_context( ).
+int init_extensions( const bool headless= false );
+
 //! renvoie la largeur de la fenetre de l'application.
 int window_width( );
 //! renvoie la hauteur de la fenetre de l'application.
@@ -67,6 +74,10 @@ int run( Window window, int (*draw)( void ) );
 
 //! fonction interne de gestion d'evenements.
 int events( Window window );
+//! fonction interne : attend un evenement, au plus timeout millisecondes, puis traite les suivants.
+int wait_events( Window window, const int timeout );
+//! reveille wait_events( ), utilisable par les autres threads.
+void wake_events( );
 
 //! renvoie le chemin(path) vers le fichier filename aprs l'avoir chercher par rapport  l'executable ou au rpertoire pre de l'executable
 const char* smart_path(const char* filename);
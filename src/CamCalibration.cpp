@@ -12,6 +12,12 @@
 using namespace cv;
 using namespace std;
 
+typedef std::chrono::steady_clock Clock;
+
+static float elapsed(Clock::time_point start, Clock::time_point stop) {
+    return std::chrono::duration<float, std::milli>(stop - start).count();
+}
+
 static void help()
 {
     cout <<  "This is a camera calibration sample." << endl
@@ -284,38 +290,133 @@ void CamCalibration::start(std::string filePath) {
 
     computeFrustum();
 
-    cam = VideoCapture(STREAMCAMERA);
+    cam = openFrameSource(captureSpec, yuv);
+    if(cam == nullptr)
+        return;
 
     Size2i s = {7,4};
     std::vector<Point2f> pointImage;
     std::vector<Point3f> pointMire = initPoint3D(7, 4, SQUARESIZE);
+    std::vector<Point3f> pointBoard;
     Mat imageMod;
     Mat rotMatrix;
     bool first = false;
     Mat imageTmp;
+    FrameContext context;   // gray, pyramid, hsv of the frame, shared by the stages below
+    unsigned long frameId = 0;
+    unsigned long droppedFrames = 0;
+
+#ifdef HAVE_OPENCV_ARUCO
+    markerDictionary = aruco::getPredefinedDictionary(aruco::DICT_4X4_50);
+    markerParameters = aruco::DetectorParameters::create();
+#else
+    if(mode == MARKER_BOARD) {
+        cout << "OpenCV built without aruco, using the chessboard" << endl;
+        mode = CHESSBOARD;
+    }
+#endif
+
     for(;;) {
 
-        cam >> imageTmp;
-        flip(imageTmp, image, 0);
-        imageTmp.copyTo(imageMod);
-        flag = findChessboardCorners(imageMod, s, pointImage, CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK);
+        PoseInfo info;
+        Clock::time_point waiting = Clock::now();
+        GrabResult grab = cam->grab(imageTmp);
+        if(grab == GRAB_END)
+            break;
+        if(grab == GRAB_DROPPED) {
+            // skip a late or undecodable frame, keep tracking with the next one
+            droppedFrames++;
+            if(stopping)
+                break;
+            continue;
+        }
+        Clock::time_point grabbed = Clock::now();
+        info.frame = ++frameId;
+        info.captured = cam->captureTime();
+        info.grab = elapsed(waiting, grabbed);
+        context.reset(imageTmp);
+        if(imageTmp.type() == CV_8UC3) {
+            flip(imageTmp, image, 0);
+            imageTmp.copyTo(imageMod);
+        }
+        else {
+            // native yuv : uploaded as is, flipped and converted by the shader, tracked on the luma plane
+            imageTmp.copyTo(image);
+            context.gray().copyTo(imageMod);
+        }
+
+        bool tracked = flag;
+        if(mode == MARKER_BOARD) {
+            flag = findMarkerBoard(context, pointImage, pointBoard);
+#ifdef HAVE_OPENCV_ARUCO
+            if(flag)
+                aruco::drawDetectedMarkers(imageMod, markerCorners, markerIds);
+#endif
+        }
+        else {
+            flag = findChessboardCorners(context.gray(), s, pointImage, CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK);
+            if(flag) {
+                cornerSubPix(context.gray(), pointImage, Size(5,5), Size(-1,-1), TermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 30, 0.1));
+                drawChessboardCorners(imageMod, s, Mat(pointImage), flag);
+            }
+        }
+
+        Clock::time_point detected = Clock::now();
+        info.detect = elapsed(grabbed, detected);
 
         if (flag) {
-            drawChessboardCorners(imageMod, s, Mat(pointImage), flag);
-
-            solvePnP(pointMire, pointImage, cameraMatrix, distCoeffs, rvec, tvec, first, CV_EPNP);
+            if(mode == MARKER_BOARD)
+                // any subset of the markers : refine the previous pose while the board stays tracked
+                solvePnP(pointBoard, pointImage, cameraMatrix, distCoeffs, rvec, tvec, tracked, CV_ITERATIVE);
+            else
+                solvePnP(pointMire, pointImage, cameraMatrix, distCoeffs, rvec, tvec, first, CV_EPNP);
+            reprojection(mode == MARKER_BOARD ? pointBoard : pointMire, pointImage, info);
             Rodrigues(rvec, rotMatrix);
 
             getEulerAngle(rotMatrix, euler);
             transform = tvec;
 
             computeTransform(rotMatrix, tvec);
+
+            if(mode == MARKER_BOARD)
+                predictMarkerRoi(context.size());
         }
+        else
+            markerRoi = Rect();
+
+        Clock::time_point posed = Clock::now();
+        info.pose = elapsed(detected, posed);
 
         // magic wand detection
-        findMagicWand(image);
+        wandVisible = findMagicWand(context);
+
+        if(latencyProbe) {
+            // brightness of the center of the frame, aim it at the blinking led
+            const Mat& gray = context.gray();
+            Rect center(gray.cols / 2 - 16, gray.rows / 2 - 16, 32, 32);
+            probeLit = mean(gray(center))[0] > LATENCY_THRESHOLD;
+            probeFrame = info.frame;
+        }
+
+        Clock::time_point done = Clock::now();
+        info.wand = elapsed(posed, done);
+        info.total = elapsed(info.captured, done);
+        info.tracked = flag;
+        stats.add(info);
+        if(published)
+            published();
+
+        // the frame goes back to the capture, its buffer is reused by the next decodes
+        context.reset(Mat());
+        cam->recycle(imageTmp);
+
+        if(stopping)
+            break;
+        if(!preview)
+            continue;
 
-        char key = (char)waitKey(50);
+        // don't throttle the camera, only let highgui refresh the window
+        char key = (char)waitKey(1);
 
         if( key  == 27 )
             break;
@@ -323,11 +424,136 @@ void CamCalibration::start(std::string filePath) {
     }
 
 
-    cam.release();
+    if(droppedFrames)
+        cout << droppedFrames << " dropped frames" << endl;
+    cam->release();
+    delete cam;
+    cam = nullptr;
+}
+
+
+
+
+void CamCalibration::reprojection(const std::vector<Point3f>& object, const std::vector<Point2f>& pointImage, PoseInfo& info) {
+    std::vector<Point2f> projected;
+    projectPoints(object, rvec, tvec, cameraMatrix, distCoeffs, projected);
+
+    double sum = 0;
+    info.inliers = 0;
+    info.points = (int) projected.size();
+    for(size_t i = 0; i < projected.size(); ++i) {
+        Point2f d = projected[i] - pointImage[i];
+        float error2 = d.dot(d);
+        sum += error2;
+        if(error2 < INLIER_ERROR * INLIER_ERROR)
+            info.inliers++;
+    }
+
+    info.rms = info.points > 0 ? (float) std::sqrt(sum / info.points) : 0.f;
+}
+
+Point3f CamCalibration::markerCorner(int id, int corner) const {
+    float pitch = MARKERSIZE + MARKERSEPARATION;
+    float x = (id % MARKERBOARD_X) * pitch;
+    float y = (id / MARKERBOARD_X) * pitch;
+
+    // aruco order : top left, top right, bottom right, bottom left
+    if(corner == 1 || corner == 2)
+        x += MARKERSIZE;
+    if(corner == 2 || corner == 3)
+        y += MARKERSIZE;
+
+    return Point3f(x, y, 0.f);
 }
 
+bool CamCalibration::findMarkerBoard(FrameContext& frame, std::vector<Point2f>& pointImage, std::vector<Point3f>& pointBoard) {
+    pointImage.clear();
+    pointBoard.clear();
+
+#ifdef HAVE_OPENCV_ARUCO
+    const Mat& gray = frame.gray();
+
+    // search around the board of the previous frame, the whole frame when it was lost
+    Rect full(0, 0, gray.cols, gray.rows);
+    Rect roi = markerRoi.area() > 0 ? (markerRoi & full) : full;
+
+    aruco::detectMarkers(gray(roi), markerDictionary, markerCorners, markerIds, markerParameters);
+    if(markerIds.empty() && roi != full) {
+        roi = full;
+        aruco::detectMarkers(gray, markerDictionary, markerCorners, markerIds, markerParameters);
+    }
+
+    for(size_t i = 0; i < markerIds.size(); ++i) {
+        for(int k = 0; k < 4; ++k)
+            markerCorners[i][k] += Point2f(roi.x, roi.y);
+
+        if(markerIds[i] >= MARKERBOARD_X * MARKERBOARD_Y)
+            continue; // not a marker of the board
+
+        for(int k = 0; k < 4; ++k) {
+            pointImage.push_back(markerCorners[i][k]);
+            pointBoard.push_back(markerCorner(markerIds[i], k));
+        }
+    }
 
+    if(pointImage.empty())
+        return false;
 
+    // only the corners of the visible markers are refined
+    cornerSubPix(gray, pointImage, Size(5,5), Size(-1,-1), TermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 30, 0.1));
+
+    // one marker alone gives an ambiguous pose : only accepted to keep an existing track
+    size_t minMarkers = markerRoi.area() > 0 ? 1 : 2;
+    return pointImage.size() >= 4 * minMarkers;
+#else
+    return false;
+#endif
+}
+
+void CamCalibration::predictMarkerRoi(const Size& size) {
+    // whole board (hidden markers included) seen with the current pose
+    std::vector<Point3f> board;
+    board.push_back(markerCorner(0, 0));
+    board.push_back(markerCorner(MARKERBOARD_X - 1, 1));
+    board.push_back(markerCorner(MARKERBOARD_X * MARKERBOARD_Y - 1, 2));
+    board.push_back(markerCorner((MARKERBOARD_Y - 1) * MARKERBOARD_X, 3));
+
+    std::vector<Point2f> projected;
+    projectPoints(board, rvec, tvec, cameraMatrix, distCoeffs, projected);
+
+    // one marker of margin for the motion until the next frame
+    Rect box = boundingRect(projected);
+    int margin = std::max(box.width / MARKERBOARD_X, box.height / MARKERBOARD_Y);
+    box.x -= margin;
+    box.y -= margin;
+    box.width += 2 * margin;
+    box.height += 2 * margin;
+
+    markerRoi = box & Rect(0, 0, size.width, size.height);
+}
+
+bool CamCalibration::writeMarkerBoard(std::string filePath, int pixelsPerMarker) {
+#ifdef HAVE_OPENCV_ARUCO
+    Ptr<aruco::Dictionary> dictionary = aruco::getPredefinedDictionary(aruco::DICT_4X4_50);
+
+    int separation = cvRound(MARKERSEPARATION * pixelsPerMarker / MARKERSIZE);
+    int pitch = pixelsPerMarker + separation;
+    Mat board(MARKERBOARD_Y * pitch + separation, MARKERBOARD_X * pitch + separation, CV_8UC1, Scalar(255));
+
+    for(int id = 0; id < MARKERBOARD_X * MARKERBOARD_Y; ++id) {
+        Mat marker;
+        aruco::drawMarker(dictionary, id, pixelsPerMarker, marker, 1);
+
+        Rect place(separation + (id % MARKERBOARD_X) * pitch, separation + (id / MARKERBOARD_X) * pitch, pixelsPerMarker, pixelsPerMarker);
+        marker.copyTo(board(place));
+    }
+
+    return imwrite(filePath, board);
+#else
+    cout << "OpenCV built without aruco, no marker board" << endl;
+    return false;
+#endif
+}
 
 void CamCalibration::getEulerAngle(Mat &rotCamerMatrix,Vec3d &eulerAngles){
 
@@ -438,40 +664,57 @@ Transform CamCalibration::lookat(const Vec3f eye, const Vec3f center, const Vec3
     return Matrix;
 }
 
-bool CamCalibration::findMagicWand(Mat& view) {
+bool CamCalibration::findMagicWand(FrameContext& frame) {
     std::vector< std::vector< cv::Point > > contours;
     std::vector<cv::Vec4i> hierarchy;
 
     // create a mask to filter the red color
-    cv::Mat hsv_foreground, mask_color, low_mask_color, high_mask_color;
-    cv::cvtColor(view, hsv_foreground, cv::COLOR_BGR2HSV);
-
-    /*
-    // red color mask in HSV
-    // first mask : low red in hsv
-    cv::Scalar low_color_hsv = cv::Scalar(160,200,70,0);
-    cv::Scalar middle_low_color_hsv = cv::Scalar(180,255,255,0);
-    // second mask : upper red in hsv
-    cv::Scalar middle_high_color_hsv = cv::Scalar(0,200,70,0);
-    cv::Scalar high_color_hsv = cv::Scalar(20,255,255,0);
-    */
-
-    // yellow color
-    cv::Scalar low_color_hsv = cv::Scalar(20, 100, 100);
-    cv::Scalar high_color_hsv = cv::Scalar(30, 255, 255);
-
-    // blue color
-    //cv::Scalar low_color_hsv = cv::Scalar(110,50,50);
-    //cv::Scalar high_color_hsv = cv::Scalar(130,255,255);
-
-    inRange(hsv_foreground, low_color_hsv, high_color_hsv, mask_color);
-
-    /*
-    // keep (white) the pixels which are between the 2 hsv values
-    inRange(hsv_foreground, low_color_hsv, middle_low_color_hsv, low_mask_color); // first mask : lower
-    inRange(hsv_foreground, middle_high_color_hsv, high_color_hsv, high_mask_color); // second mask : upper
-    bitwise_or(low_mask_color, high_mask_color, mask_color); // merge of the two masks
-    */
+    cv::Mat mask_color, low_mask_color, high_mask_color;
+    cv::Point2f scale(1.f, 1.f);   // mask to image coordinates
+    bool yuv = frame.isYUV();
+
+    if(!yuv) {
+        // the camera frame, not flipped
+        const cv::Mat& hsv_foreground = frame.hsv();
+
+        /*
+        // red color mask in HSV
+        // first mask : low red in hsv
+        cv::Scalar low_color_hsv = cv::Scalar(160,200,70,0);
+        cv::Scalar middle_low_color_hsv = cv::Scalar(180,255,255,0);
+        // second mask : upper red in hsv
+        cv::Scalar middle_high_color_hsv = cv::Scalar(0,200,70,0);
+        cv::Scalar high_color_hsv = cv::Scalar(20,255,255,0);
+        */
+
+        // yellow color
+        cv::Scalar low_color_hsv = cv::Scalar(20, 100, 100);
+        cv::Scalar high_color_hsv = cv::Scalar(30, 255, 255);
+
+        // blue color
+        //cv::Scalar low_color_hsv = cv::Scalar(110,50,50);
+        //cv::Scalar high_color_hsv = cv::Scalar(130,255,255);
+
+        inRange(hsv_foreground, low_color_hsv, high_color_hsv, mask_color);
+
+        /*
+        // keep (white) the pixels which are between the 2 hsv values
+        inRange(hsv_foreground, low_color_hsv, middle_low_color_hsv, low_mask_color); // first mask : lower
+        inRange(hsv_foreground, middle_high_color_hsv, high_color_hsv, high_mask_color); // second mask : upper
+        bitwise_or(low_mask_color, high_mask_color, mask_color); // merge of the two masks
+        */
+    }
+    else if(frame.frame().type() == CV_8UC2) {
+        // yellow in YUYV : bright, low u (Cb), v (Cr) a bit above neutral
+        // read as y0 u y1 v pixel pairs, the mask has half the width
+        inRange(frame.chroma(), cv::Scalar(80, 0, 0, 135), cv::Scalar(255, 100, 255, 180), mask_color);
+        scale = cv::Point2f(2.f, 1.f);
+    }
+    else {
+        // NV12 : interleaved u v plane below the luma, half width and half height
+        inRange(frame.chroma(), cv::Scalar(0, 135), cv::Scalar(100, 180), mask_color);
+        scale = cv::Point2f(2.f, 2.f);
+    }
 
     //imshow("mask", mask_color);
 
@@ -487,8 +730,10 @@ bool CamCalibration::findMagicWand(Mat& view) {
     // search the center of the red torso
     if(contours.size() > 0) {
         cv::Moments mu = moments(contours[0]);
-        cv::Point center(mu.m10/mu.m00 , mu.m01/mu.m00);
+        cv::Point center(mu.m10/mu.m00 * scale.x, mu.m01/mu.m00 * scale.y);
+        // same convention as the flipped image sent to the renderer
+        center.y = (int) (mask_color.rows * scale.y) - 1 - center.y;
         magicWand = center;
-        cv::rectangle(view, cv::Point(center.x-5, center.y-5), cv::Point(center.x+5, center.y+5), cv::Scalar(0, 0, 255), 1, 8, 0);
     }
+    return contours.size() > 0;
 }
\ No newline at end of file
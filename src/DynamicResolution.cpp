@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <program.h>
+#include <uniforms.h>
+#include <state.h>
+
+#include "DynamicResolution.h"
+
+static const float MIN_SCALE = 0.5f;
+static const int SCALE_FRAMES = 30;     // the profiler averages about 30 frames : wait before measuring a new scale again
+static const float SCALE_STEP = 0.05f;  // ignore smaller changes, the size of the image would change every few frames
+
+void DynamicResolution::init(int _width, int _height, float _budget) {
+    width = _width;
+    height = _height;
+    budget = _budget;
+    scale = 1.f;
+    frames = 0;
+
+    // full size once, only a part is used at lower scales
+    glGenTextures(1, &color);
+    state_bind_texture(0, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color, 0);
+    glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if(glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        printf("[error] dynamic resolution framebuffer %dx%d is incomplete...\n", width, height);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+    program = read_program("data/composite.glsl");
+    program_print_errors(program);
+    glGenVertexArrays(1, &vao);
+}
+
+void DynamicResolution::release() {
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depth);
+    state_delete_textures(1, &color);
+    state_delete_vertex_arrays(1, &vao);
+    release_program(program);
+    framebuffer = 0;
+    depth = 0;
+    color = 0;
+    vao = 0;
+    program = 0;
+}
+
+int DynamicResolution::scaledWidth()const {
+    return std::max(1, (int) (width * scale + 0.5f));
+}
+
+int DynamicResolution::scaledHeight()const {
+    return std::max(1, (int) (height * scale + 0.5f));
+}
+
+void DynamicResolution::update(float gpuTime) {
+    if(++frames < SCALE_FRAMES || gpuTime <= 0.f)
+        return;
+
+    // the cost is about the number of pixels : scale^2
+    float target = std::min(std::max(scale * std::sqrt(budget / gpuTime), MIN_SCALE), 1.f);
+    if(std::fabs(target - scale) < SCALE_STEP)
+        return;
+
+    // half way : the upload and the background do not depend on the scale, the estimate overshoots
+    scale += (target - scale) * 0.5f;
+    if(scale > 1.f - SCALE_STEP)
+        scale = 1.f;
+    frames = 0;
+}
+
+void DynamicResolution::begin() {
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, scaledWidth(), scaledHeight());
+
+    // transparent, without changing the clear color of the window
+    const GLfloat transparent[4] = {0, 0, 0, 0};
+    glClearBufferfv(GL_COLOR, 0, transparent);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void DynamicResolution::end() {
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    if(!program_ready(program))
+        return;
+
+    state_bind_vertex_array(vao);
+    state_use_program(program);
+    program_uniform(program, "viewport", vec2(width, height));
+    program_uniform(program, "extent", vec2(float(scaledWidth()) / width, float(scaledHeight()) / height));
+    program_use_texture(program, "color", 0, color);
+
+    state_enable(GL_BLEND);
+    state_blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    state_polygon_mode(GL_FILL);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    state_disable(GL_BLEND);
+}
+
+void DynamicResolution::print(Text& console, int x, int y)const {
+    printf(console, x, y, "resolution %3d%% %dx%d, budget %.1fms", (int) (scale * 100.f + 0.5f), scaledWidth(), scaledHeight(), budget);
+}
@@ -0,0 +1,70 @@
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "FrameContext.h"
+
+using namespace cv;
+
+void FrameContext::reset(const Mat& frame) {
+    // the NV12 luma is a view of the previous frame, it can't be reused as a buffer
+    if(!grayImage.empty() && grayImage.u == image.u)
+        grayImage.release();
+
+    image = frame;
+    hasGray = false;
+    hasHsv = false;
+    levelCount = 0;
+}
+
+Size FrameContext::size()const {
+    if(image.type() == CV_8UC1)
+        return Size(image.cols, image.rows * 2 / 3);
+    return image.size();
+}
+
+const Mat& FrameContext::gray() {
+    if(hasGray)
+        return grayImage;
+
+    if(image.type() == CV_8UC3)
+        cvtColor(image, grayImage, COLOR_BGR2GRAY);
+    else if(image.type() == CV_8UC2)
+        extractChannel(image, grayImage, 0);
+    else
+        grayImage = image.rowRange(0, image.rows * 2 / 3);
+
+    hasGray = true;
+    return grayImage;
+}
+
+const Mat& FrameContext::level(int i) {
+    if(i == 0)
+        return gray();
+
+    if((int) levels.size() < i)
+        levels.resize(i);
+
+    for(int l = levelCount; l < i; ++l)
+        pyrDown(l == 0 ? gray() : levels[l - 1], levels[l]);
+    if(levelCount < i)
+        levelCount = i;
+
+    return levels[i - 1];
+}
+
+const Mat& FrameContext::hsv() {
+    CV_Assert(image.type() == CV_8UC3);
+    if(!hasHsv)
+        cvtColor(image, hsvImage, COLOR_BGR2HSV);
+
+    hasHsv = true;
+    return hsvImage;
+}
+
+Mat FrameContext::chroma()const {
+    CV_Assert(isYUV());
+    if(image.type() == CV_8UC2)
+        return Mat(image.rows, image.cols / 2, CV_8UC4, image.data, image.step);
+
+    int height = image.rows * 2 / 3;
+    return Mat(height / 2, image.cols / 2, CV_8UC2, (void*) image.ptr(height), image.step);
+}
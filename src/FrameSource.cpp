@@ -0,0 +1,255 @@
+#include <fstream>
+#include <iostream>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "CamCalibration.h"
+#include "FrameSource.h"
+#include "V4L2Source.h"
+
+using namespace cv;
+using namespace std;
+
+DecodePool::DecodePool(int workers) : idle(workers), submitted(0), published(0), failed(0), delivered(0), stopped(false) {
+    for(int i = 0; i < workers; ++i)
+        threads.push_back(std::thread(&DecodePool::work, this));
+}
+
+DecodePool::~DecodePool() {
+    stop();
+}
+
+bool DecodePool::submit(Format format, const uchar* data, size_t size, int width, int height, size_t step, CaptureTime stamp, std::function<void()> done) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // never queue behind a busy worker, a late frame is worth less than the next one
+        if(stopped || (int) jobs.size() >= idle)
+            return false;
+
+        Job job = {format, data, size, width, height, step, stamp, done, ++submitted};
+        jobs.push_back(job);
+    }
+    jobReady.notify_one();
+    return true;
+}
+
+GrabResult DecodePool::latest(Mat& frame, CaptureTime& stamp, int timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto ready = [this]{ return stopped || published > delivered || failed > delivered; };
+    if(timeout < 0)
+        frameReady.wait(lock, ready);
+    else
+        frameReady.wait_for(lock, std::chrono::milliseconds(timeout), ready);
+    if(stopped)
+        return GRAB_END;
+    if(published <= delivered) {
+        // late or corrupted frame, the caller tries again with the next one
+        delivered = std::max(delivered, failed);
+        return GRAB_DROPPED;
+    }
+
+    // the consumer owns the frame until recycle()
+    frame = newest;
+    newest.release();
+    stamp = newestStamp;
+    delivered = published;
+    return GRAB_FRAME;
+}
+
+void DecodePool::recycle(Mat& frame) {
+    if(frame.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBuffers.push_back(frame);
+    }
+    frame.release();
+}
+
+void DecodePool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        jobs.clear();
+    }
+    jobReady.notify_all();
+    frameReady.notify_all();
+
+    for(size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+    threads.clear();
+}
+
+void DecodePool::work() {
+    for(;;) {
+        Job job;
+        Mat decoded;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [this]{ return stopped || !jobs.empty(); });
+            if(stopped)
+                return;
+
+            job = jobs.front();
+            jobs.pop_front();
+            idle--;
+
+            // a buffer given back by the consumer, or a new one
+            if(!freeBuffers.empty()) {
+                decoded = freeBuffers.back();
+                freeBuffers.pop_back();
+            }
+        }
+
+        // decode straight from the capture buffer
+        if(job.format == MJPEG)
+            imdecode(Mat(1, (int) job.size, CV_8UC1, (void*) job.data), IMREAD_COLOR, &decoded);
+        else if(job.format == YUYV)
+            cvtColor(Mat(job.height, job.width, CV_8UC2, (void*) job.data, job.step), decoded, COLOR_YUV2BGR_YUYV);
+        else if(job.format == YUYV_RAW)
+            Mat(job.height, job.width, CV_8UC2, (void*) job.data, job.step).copyTo(decoded);
+        else
+            Mat(job.height * 3 / 2, job.width, CV_8UC1, (void*) job.data, job.step).copyTo(decoded);
+        job.done();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle++;
+            if(decoded.empty()) {
+                // corrupted frame, don't let the consumer wait for it
+                failed = std::max(failed, job.id);
+                frameReady.notify_all();
+                continue;
+            }
+            if(job.id < published) {
+                // a newer one already published
+                freeBuffers.push_back(decoded);
+                continue;
+            }
+
+            // the previous frame was never delivered, its buffer is free again
+            if(!newest.empty())
+                freeBuffers.push_back(newest);
+            newest = decoded;
+            newestStamp = job.stamp;
+            published = job.id;
+        }
+        frameReady.notify_all();
+    }
+}
+
+
+bool CvSource::open() {
+    if(camera >= 0)
+        capture.open(camera);
+    else
+        capture.open(file);
+    return capture.isOpened();
+}
+
+GrabResult CvSource::grab(Mat& frame) {
+    if(!capture.isOpened())
+        return GRAB_END;
+    capture >> frame;
+    stamp = std::chrono::steady_clock::now();
+    if(!frame.empty())
+        return GRAB_FRAME;
+    // the end of a video file, a camera hiccup otherwise
+    return camera < 0 ? GRAB_END : GRAB_DROPPED;
+}
+
+void CvSource::release() {
+    capture.release();
+}
+
+
+bool MjpegFileSource::open() {
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if(!in.good())
+        return false;
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    // split the stream on the jpeg start / end of image markers
+    frames.clear();
+    size_t start = 0;
+    bool inside = false;
+    for(size_t i = 0; i + 1 < data.size(); ++i) {
+        if(data[i] != 0xFF)
+            continue;
+        if(!inside && data[i + 1] == 0xD8) {
+            start = i;
+            inside = true;
+        }
+        else if(inside && data[i + 1] == 0xD9) {
+            frames.push_back(std::make_pair(start, i + 2 - start));
+            inside = false;
+        }
+    }
+
+    next = 0;
+    deadline = std::chrono::steady_clock::now();
+    cout << "replay " << file << " : " << frames.size() << " frames" << endl;
+    return !frames.empty();
+}
+
+GrabResult MjpegFileSource::grab(Mat& frame) {
+    if(frames.empty())
+        return GRAB_END;
+
+    // paced like the camera
+    deadline += std::chrono::microseconds(1000000 / fps);
+    std::this_thread::sleep_until(deadline);
+
+    const std::pair<size_t, size_t>& f = frames[next];
+    next = (next + 1) % frames.size();
+    // captured when the camera would have delivered it
+    if(!pool.submit(DecodePool::MJPEG, &data[f.first], f.second, 0, 0, 0, deadline, []{}))
+        return GRAB_DROPPED;
+    return pool.latest(frame, stamp, 1000);
+}
+
+void MjpegFileSource::release() {
+    pool.stop();
+    frames.clear();
+    data.clear();
+}
+
+
+static bool endsWith(const std::string& s, const std::string& end) {
+    return s.size() >= end.size() && s.compare(s.size() - end.size(), end.size(), end) == 0;
+}
+
+FrameSource* openFrameSource(const std::string& spec, bool yuv) {
+    std::vector<FrameSource*> candidates;
+
+    if(spec.empty()) {
+#ifdef __linux__
+        candidates.push_back(new V4L2Source("/dev/video" + std::to_string(STREAMCAMERA)));
+#endif
+        candidates.push_back(new CvSource(STREAMCAMERA));
+    }
+    else if(endsWith(spec, ".mjpg") || endsWith(spec, ".mjpeg"))
+        candidates.push_back(new MjpegFileSource(spec));
+#ifdef __linux__
+    else if(spec.compare(0, 5, "/dev/") == 0)
+        candidates.push_back(new V4L2Source(spec));
+#endif
+    else if(spec.find_first_not_of("0123456789") == std::string::npos)
+        candidates.push_back(new CvSource(std::stoi(spec)));
+    else
+        candidates.push_back(new CvSource(spec));
+
+    FrameSource* source = nullptr;
+    for(size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i]->keepYUV(yuv);
+        if(source == nullptr && candidates[i]->open())
+            source = candidates[i];
+        else
+            delete candidates[i];
+    }
+
+    if(source == nullptr)
+        cout << "no capture source '" << spec << "'" << endl;
+    return source;
+}
@@ -0,0 +1,115 @@
+#include "LatencyMeter.h"
+
+static const int LATENCY_RESYNC = 300;  // frames between two gpu / cpu clock synchronizations
+
+static float elapsed(CaptureTime start, CaptureTime stop) {
+    return std::chrono::duration<float, std::milli>(stop - start).count();
+}
+
+LatencyMeter::LatencyMeter() : lastFrame(0), offset(0), frames(0),
+                               render(50.f, 25), gpu(100.f, 25), swap(100.f, 25), fence(100.f, 25) {}
+
+void LatencyMeter::init() {
+    synchronize();
+}
+
+void LatencyMeter::release() {
+    for(size_t i = 0; i < pending.size(); ++i) {
+        if(pending[i].fence)
+            glDeleteSync(pending[i].fence);
+        queries.push_back(pending[i].query);
+    }
+    pending.clear();
+
+    if(!queries.empty())
+        glDeleteQueries((GLsizei) queries.size(), queries.data());
+    queries.clear();
+}
+
+void LatencyMeter::synchronize() {
+    // current gpu time, without waiting for the queued commands
+    GLint64 now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &now);
+    long long cpu = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    offset = cpu - now;
+}
+
+void LatencyMeter::rendered(unsigned long frame, CaptureTime captured, CaptureTime started) {
+    // only the first presentation of a camera image
+    if(frame == 0 || frame == lastFrame)
+        return;
+    lastFrame = frame;
+
+    if(++frames % LATENCY_RESYNC == 0)
+        synchronize();
+
+    GLuint query = 0;
+    if(queries.empty())
+        glGenQueries(1, &query);
+    else {
+        query = queries.back();
+        queries.pop_back();
+    }
+
+    // gpu time once every command of the frame is executed
+    glQueryCounter(query, GL_TIMESTAMP);
+
+    Pending p;
+    p.captured = captured;
+    p.started = started;
+    p.query = query;
+    p.fence = 0;
+    pending.push_back(p);
+}
+
+void LatencyMeter::presented() {
+    if(!pending.empty() && pending.back().fence == 0) {
+        pending.back().swapped = std::chrono::steady_clock::now();
+        // signaled once the gpu is done with the frame and the swap
+        pending.back().fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    collect();
+}
+
+void LatencyMeter::collect() {
+    while(!pending.empty() && pending.front().fence) {
+        Pending& p = pending.front();
+        // never wait, look again after the next frame
+        GLenum status = glClientWaitSync(p.fence, 0, 0);
+        if(status == GL_TIMEOUT_EXPIRED)
+            break;
+
+        CaptureTime signaled = std::chrono::steady_clock::now();
+        GLuint64 done = 0;
+        glGetQueryObjectui64v(p.query, GL_QUERY_RESULT, &done);
+        CaptureTime finished(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds((long long) done + offset)));
+
+        render.add(elapsed(p.captured, p.started));
+        gpu.add(elapsed(p.captured, finished));
+        swap.add(elapsed(p.captured, p.swapped));
+        fence.add(elapsed(p.captured, signaled));
+
+        glDeleteSync(p.fence);
+        queries.push_back(p.query);
+        pending.pop_front();
+    }
+}
+
+void LatencyMeter::dump(std::ostream& out)const {
+    out << "latency : " << frames << " frames, capture to" << std::endl;
+    out << "                 mean     p50     p95     max" << std::endl;
+    out << render.summary("render ms") << std::endl;
+    out << gpu.summary("gpu ms") << std::endl;
+    out << swap.summary("swap ms") << std::endl;
+    out << fence.summary("fence ms") << std::endl;
+}
+
+void LatencyMeter::print(Text& console, int x, int y)const {
+    printf(console, x, y, "latency, capture to        (%d frames)", frames);
+    printf(console, x, y + 1, "                 mean     p50     p95     max");
+    printf(console, x, y + 2, "%s", render.summary("render ms").c_str());
+    printf(console, x, y + 3, "%s", gpu.summary("gpu ms").c_str());
+    printf(console, x, y + 4, "%s", swap.summary("swap ms").c_str());
+    printf(console, x, y + 5, "%s", fence.summary("fence ms").c_str());
+}
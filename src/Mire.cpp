@@ -92,6 +92,10 @@ Mire::Mire(int row, int col, float squareSize, Transform t): Mesh(GL_TRIANGLES)
             vertex(f.x, f.y, f.z);
         }
     }
+    // shared vertices, drawn in cache order, 16 bits indices for small models
+    optimize();
+    // 16 bits positions in the bounding box, recomputed when setHeight() updates the buffers
+    vertex_format(VERTEX_FORMAT_QUANTIZED);
     transform = t;
 }
 
@@ -120,27 +124,17 @@ Color Mire::interpColor(const Color &base, const Color &max, float val) {
     return (1-val) * base + val * max;
 }
 
-Object::Object(Transform t, std::string filename, vec3 objectColor) {
+Object::Object(Transform t, std::string filename, vec3 objectColor) : Mesh(GL_TRIANGLES) {
 
     Mesh mesh = read_mesh(filename.c_str());
     if(mesh == Mesh::error()) exit(0);
 
-    std::vector<TriangleData> tmp_triangle;
-    std::vector<vec3> tmp_vec3;
-
-    for(int i= 0; i < mesh.triangle_count(); i++)
-        tmp_triangle.push_back( mesh.triangle(i) );
-
-    for(int i= 0; i < tmp_triangle.size(); i++) {
-        tmp_vec3.push_back(tmp_triangle[i].a);
-        tmp_vec3.push_back(tmp_triangle[i].b);
-        tmp_vec3.push_back(tmp_triangle[i].c);
-    }
-
-    for(int i = 0; i < tmp_vec3.size(); i++) {
-        color(objectColor.x, objectColor.y, objectColor.z);
-        vertex(tmp_vec3[i]);
-    }
+    // take the loaded geometry as is, one color for the whole object
+    adopt(std::move(mesh));
+    constant_color(Color(objectColor.x, objectColor.y, objectColor.z));
 
+    // shared vertices, drawn in cache order, 16 bits indices for small models
+    optimize();
+    vertex_format(VERTEX_FORMAT_QUANTIZED);
     transform = t;
 }
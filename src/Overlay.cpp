@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include <program.h>
+#include <uniforms.h>
+#include <state.h>
+
+#include "Overlay.h"
+
+void Overlay::init() {
+    program = read_program("data/overlay.glsl");
+    program_print_errors(program);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &buffer);
+}
+
+void Overlay::release() {
+    release_program(program);
+    state_delete_vertex_arrays(1, &vao);
+    glDeleteBuffers(1, &buffer);
+    program = 0;
+    vao = 0;
+    buffer = 0;
+    capacity = 0;
+}
+
+void Overlay::clear() {
+    instances.clear();
+}
+
+void Overlay::marker(const Point& center, float halfSize, const Color& color) {
+    Instance i;
+    i.x = center.x;
+    i.y = center.y;
+    i.size = halfSize;
+    i.color[0] = (unsigned char) (std::min(std::max(color.r, 0.f), 1.f) * 255.f);
+    i.color[1] = (unsigned char) (std::min(std::max(color.g, 0.f), 1.f) * 255.f);
+    i.color[2] = (unsigned char) (std::min(std::max(color.b, 0.f), 1.f) * 255.f);
+    i.color[3] = (unsigned char) (std::min(std::max(color.a, 0.f), 1.f) * 255.f);
+    instances.push_back(i);
+}
+
+void Overlay::draw(int width, int height) {
+    if(instances.empty() || !program_ready(program))
+        return;
+
+    state_bind_vertex_array(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if(instances.size() > capacity) {
+        // the vertex format only changes with the buffer
+        capacity = instances.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Instance), (const void*) offsetof(Instance, x));
+        glVertexAttribDivisor(0, 1);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Instance), (const void*) offsetof(Instance, size));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance), (const void*) offsetof(Instance, color));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(2);
+    }
+    else
+        // orphan the previous frame's instances
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(Instance), instances.data());
+
+    state_use_program(program);
+    program_uniform(program, "viewport", vec2(width, height));
+
+    glDrawArraysInstanced(GL_LINES, 0, 8, (GLsizei) instances.size());
+}
@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <cstring>
+
+#include <image_convert.h>
+
+#include "Recorder.h"
+
+Recorder::Recorder() : head(0), count(0), width(0), height(0), stopping(false), recorded(0), dropped(0), encoded(0) {}
+
+Recorder::~Recorder() {
+    // the buffers belong to the gl context, stop() must be called before it is released
+    if(encoder.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        encoder.join();
+    }
+}
+
+bool Recorder::start(const std::string& file, int _width, int _height, double fps) {
+    width = _width;
+    height = _height;
+
+    if(file.find('%') != std::string::npos)
+        pattern = file;
+    else {
+        std::string extension = file.substr(file.find_last_of('.') + 1);
+        int fourcc = (extension == "mp4") ? cv::VideoWriter::fourcc('m', 'p', '4', 'v') : cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        if(!writer.open(file, fourcc, fps, cv::Size(width, height), true)) {
+            printf("[error] recording '%s'...\n", file.c_str());
+            return false;
+        }
+    }
+    printf("recording '%s' %dx%d...\n", file.c_str(), width, height);
+
+    slots.resize(RECORD_BUFFERS);
+    for(size_t i = 0; i < slots.size(); ++i) {
+        glGenBuffers(1, &slots[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr, GL_STREAM_READ);
+        slots[i].fence = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    head = 0;
+    count = 0;
+
+    stopping = false;
+    encoder = std::thread(&Recorder::encode, this);
+    return true;
+}
+
+void Recorder::collect(bool wait) {
+    while(count > 0) {
+        Slot& slot = slots[head];
+        GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+        if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            if(!wait)
+                return;
+            printf("[error] recording : read back timeout...\n");
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+
+        // the copy is done by the gpu : only a memcpy here, the flip and the conversion are done by the encoder
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 4, GL_MAP_READ_BIT);
+        if(data) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if(queue.size() < RECORD_QUEUE) {
+                cv::Mat image(height, width, CV_8UC4);
+                memcpy(image.data, data, width * height * 4);
+                queue.push_back(image);
+                recorded++;
+            }
+            else
+                dropped++;
+            lock.unlock();
+            ready.notify_one();
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        head = (head + 1) % RECORD_BUFFERS;
+        count--;
+    }
+}
+
+void Recorder::frame() {
+    if(!recording())
+        return;
+
+    collect(false);
+    if(count == RECORD_BUFFERS) {
+        // the gpu is late, don't wait for it
+        std::lock_guard<std::mutex> lock(mutex);
+        dropped++;
+        return;
+    }
+
+    // asynchronous : glReadPixels returns once the copy is queued
+    Slot& slot = slots[(head + count) % RECORD_BUFFERS];
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    count++;
+}
+
+void Recorder::stop() {
+    if(!recording())
+        return;
+
+    collect(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    encoder.join();
+    writer.release();
+
+    for(size_t i = 0; i < slots.size(); ++i)
+        glDeleteBuffers(1, &slots[i].buffer);
+    slots.clear();
+
+    printf("recorded %lu frames, %lu dropped\n", encoded, dropped);
+}
+
+void Recorder::encode() {
+    cv::Mat bgr;
+    for(;;) {
+        cv::Mat image;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !queue.empty(); });
+            // the queue is emptied before stopping
+            if(queue.empty())
+                return;
+            image = queue.front();
+            queue.pop_front();
+        }
+
+        // gl rows are bottom up : flip and drop alpha in one pass
+        const int offsets[4] = {0, 1, 2, -1};
+        bgr.create(image.rows, image.cols, CV_8UC3);
+        convert_pixels(image.data, (int) image.step, 4, offsets, bgr.data, (int) bgr.step, 3, image.cols, image.rows, true);
+        if(writer.isOpened())
+            writer.write(bgr);
+        else {
+            char filename[1024];
+            snprintf(filename, sizeof(filename), pattern.c_str(), (int) encoded);
+            cv::imwrite(filename, bgr);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        encoded++;
+    }
+}
+
+void Recorder::print(Text& console, int x, int y) {
+    std::lock_guard<std::mutex> lock(mutex);
+    printf(console, x, y, "recording %lu frames, %lu encoded, %lu dropped", recorded, encoded, dropped);
+}
@@ -8,6 +8,7 @@
 #include <glcore.h>
 #include <program.h>
 #include <uniforms.h>
+#include <state.h>
 #include <window.h>
 
 std::string Shader::read(const char *filename ){
@@ -32,13 +33,13 @@ Shader::Shader(char *filename, int nbv) {
     //prepass = read_program("src/Shaders/prePass.glsl");
     glGenVertexArrays(1, &vertexArray);
 
-    glUseProgram(0);
-    glBindVertexArray(0);
+    state_use_program(0);
+    state_bind_vertex_array(0);
     nbVertex = nbv;
 }
 
 void Shader::setVertexArray(GLuint _vao) {
-    glDeleteVertexArrays(1, &vertexArray);
+    state_delete_vertex_arrays(1, &vertexArray);
     vertexArray = _vao;
 }
 
@@ -46,7 +47,7 @@ void Shader::setVertexArray(const std::vector<Vector>& vec) {
 
     GLuint size;
     size = vec.size() * sizeof(Vector);
-    glDeleteVertexArrays(1, &vertexArray);
+    state_delete_vertex_arrays(1, &vertexArray);
     glGenVertexArrays(1, &vertexArray);
     glGenBuffers(1, &buffer);
     glBindBuffer(GL_ARRAY_BUFFER, buffer);
@@ -56,14 +57,14 @@ void Shader::setVertexArray(const std::vector<Vector>& vec) {
 
     glBufferSubData(GL_ARRAY_BUFFER, offset, size, &vec[0].x);
 
-    glBindVertexArray(0);
+    state_bind_vertex_array(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void Shader::setVertexArray(const float *vec, int nb) {
     GLuint size;
     size = nb * sizeof(float);
-    glDeleteVertexArrays(1, &vertexArray);
+    state_delete_vertex_arrays(1, &vertexArray);
     glGenVertexArrays(1, &vertexArray);
     glGenBuffers(1, &buffer);
     glBindBuffer(GL_ARRAY_BUFFER, buffer);
@@ -73,17 +74,29 @@ void Shader::setVertexArray(const float *vec, int nb) {
 
     glBufferSubData(GL_ARRAY_BUFFER, offset, size, vec);
 
-    glBindVertexArray(0);
+    state_bind_vertex_array(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void Shader::draw(const Transform& view, const Transform& proj, GLuint texture) {
-    glBindVertexArray(vertexArray);
-    glUseProgram(program);
-
-    Transform MVP = proj*view*Identity();
+    draw(view, proj, texture, 0, 0);
+}
 
-    program_uniform(program, "mvpMatrix", MVP);
-    program_use_texture(program, "diffuse_color", 0, texture);
+void Shader::draw(const Transform& view, const Transform& proj, GLuint texture, GLuint chroma, int yuvFormat) {
+    state_bind_vertex_array(vertexArray);
+    state_use_program(program);
+
+    // fullscreen triangle : view and proj are not used by the shader
+    // locations resolved once per link, cf program_uniform_slots()
+    static const int yuvFormatSlot = uniform_slot("yuv_format");
+    static const int chromaSlot = uniform_slot("chroma_color");
+    const GLint* slots = program_uniform_slots(program);
+    glUniform1i(slots[yuvFormatSlot], yuvFormat);
+    state_bind_texture(0, texture);
+    glUniform1i(slots[UNIFORM_DIFFUSE_COLOR], 0);
+    if(slots[chromaSlot] >= 0){
+        state_bind_texture(1, chroma);
+        glUniform1i(slots[chromaSlot], 1);
+    }
     glDrawArrays(GL_TRIANGLES, 0, nbVertex);
 }
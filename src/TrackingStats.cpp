@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "TrackingStats.h"
+
+Histogram::Histogram(float max, int bins, int window) : max(max), counts(bins, 0), values(window, 0.f), next(0), filled(0), sum(0) {}
+
+int Histogram::bin(float value)const {
+    int b = (int) (value / max * counts.size());
+    return std::min(std::max(b, 0), (int) counts.size() - 1);
+}
+
+void Histogram::add(float value) {
+    // forget the oldest value once the window is full
+    if(filled == (int) values.size()) {
+        counts[bin(values[next])]--;
+        sum -= values[next];
+    }
+    else
+        filled++;
+
+    values[next] = value;
+    counts[bin(value)]++;
+    sum += value;
+    next = (next + 1) % values.size();
+}
+
+float Histogram::maximum()const {
+    float m = 0.f;
+    for(int i = 0; i < filled; ++i)
+        m = std::max(m, values[i]);
+    return m;
+}
+
+float Histogram::percentile(float p)const {
+    int n = 0;
+    for(size_t b = 0; b < counts.size(); ++b) {
+        n += counts[b];
+        if(n >= p * filled)
+            return (b + 1) * max / counts.size();
+    }
+    return max;
+}
+
+std::string Histogram::summary(const char* name)const {
+    static const char shades[] = " .:-=+*#%@";
+
+    int highest = 1;
+    for(int c : counts)
+        highest = std::max(highest, c);
+
+    std::string shape;
+    for(int c : counts)
+        shape += shades[(c * 9 + highest - 1) / highest];
+
+    char tmp[160];
+    snprintf(tmp, sizeof(tmp), "%-10s %7.2f %7.2f %7.2f %7.2f  [%s] 0-%g",
+             name, mean(), percentile(.5f), percentile(.95f), maximum(), shape.c_str(), max);
+    return tmp;
+}
+
+TrackingStats::TrackingStats(int window) : frames(0), tracked(1.f, 2, window), rms(5.f, 20, window),
+                                           grab(50.f, 25, window), detect(50.f, 25, window), pose(10.f, 20, window),
+                                           wand(20.f, 20, window), total(100.f, 25, window) {}
+
+void TrackingStats::add(const PoseInfo& info) {
+    std::lock_guard<std::mutex> lock(mutex);
+    latest = info;
+    frames++;
+
+    tracked.add(info.tracked ? 1.f : 0.f);
+    if(info.tracked)
+        rms.add(info.rms);
+    grab.add(info.grab);
+    detect.add(info.detect);
+    pose.add(info.pose);
+    wand.add(info.wand);
+    total.add(info.total);
+}
+
+PoseInfo TrackingStats::last()const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return latest;
+}
+
+void TrackingStats::dump(std::ostream& out)const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    out << "tracking : " << frames << " frames, " << (int) (tracked.mean() * 100.f) << "% tracked over the last " << tracked.count() << std::endl;
+    out << "                 mean     p50     p95     max" << std::endl;
+    out << rms.summary("rms px") << std::endl;
+    out << grab.summary("grab ms") << std::endl;
+    out << detect.summary("detect ms") << std::endl;
+    out << pose.summary("pose ms") << std::endl;
+    out << wand.summary("wand ms") << std::endl;
+    out << total.summary("total ms") << std::endl;
+}
+
+void TrackingStats::print(Text& console, int x, int y)const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    printf(console, x, y, "frame %lu  %s  rms %.2fpx  inliers %d/%d", latest.frame, latest.tracked ? "tracked" : "lost",
+           latest.rms, latest.inliers, latest.points);
+    printf(console, x, y + 1, "tracked %d%% of the last %d frames", (int) (tracked.mean() * 100.f), tracked.count());
+    printf(console, x, y + 2, "                 mean     p50     p95     max");
+    printf(console, x, y + 3, "%s", rms.summary("rms px").c_str());
+    printf(console, x, y + 4, "%s", grab.summary("grab ms").c_str());
+    printf(console, x, y + 5, "%s", detect.summary("detect ms").c_str());
+    printf(console, x, y + 6, "%s", pose.summary("pose ms").c_str());
+    printf(console, x, y + 7, "%s", wand.summary("wand ms").c_str());
+    printf(console, x, y + 8, "%s", total.summary("total ms").c_str());
+}
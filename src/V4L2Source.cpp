@@ -0,0 +1,223 @@
+#include "V4L2Source.h"
+
+#ifdef __linux__
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+using namespace std;
+
+static int xioctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do
+        r = ioctl(fd, request, arg);
+    while(r == -1 && errno == EINTR);
+    return r;
+}
+
+V4L2Source::V4L2Source(std::string device, int width, int height, int fps, int bufferCount)
+        : device(device), width(width), height(height), fps(fps), bufferCount(bufferCount), yuv(false),
+          fd(-1), pixelFormat(0), bytesPerLine(0), running(false) {}
+
+bool V4L2Source::open() {
+    fd = ::open(device.c_str(), O_RDWR | O_NONBLOCK);
+    if(fd < 0)
+        return false;
+
+    v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if(xioctl(fd, VIDIOC_QUERYCAP, &cap) < 0 || !(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(cap.capabilities & V4L2_CAP_STREAMING)) {
+        cout << device << " : not a streaming capture device" << endl;
+        release();
+        return false;
+    }
+
+    if(!negotiate() || !mapBuffers()) {
+        release();
+        return false;
+    }
+
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if(xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+        cout << device << " : stream on failed" << endl;
+        release();
+        return false;
+    }
+
+    running = true;
+    thread = std::thread(&V4L2Source::capture, this);
+    return true;
+}
+
+bool V4L2Source::negotiate() {
+    // MJPEG keeps 60 fps at resolutions where YUYV saturates the usb bandwidth,
+    // but native yuv frames go to the gpu without any conversion
+    std::vector<unsigned int> formats;
+    if(yuv) {
+        formats.push_back(V4L2_PIX_FMT_YUYV);
+        formats.push_back(V4L2_PIX_FMT_NV12);
+    }
+    formats.push_back(V4L2_PIX_FMT_MJPEG);
+    formats.push_back(V4L2_PIX_FMT_YUYV);
+
+    for(unsigned int format : formats) {
+        v4l2_format fmt;
+        memset(&fmt, 0, sizeof(fmt));
+        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        fmt.fmt.pix.width = width;
+        fmt.fmt.pix.height = height;
+        fmt.fmt.pix.pixelformat = format;
+        fmt.fmt.pix.field = V4L2_FIELD_NONE;
+
+        if(xioctl(fd, VIDIOC_S_FMT, &fmt) < 0 || fmt.fmt.pix.pixelformat != format)
+            continue;
+
+        // the driver may pick the nearest size
+        pixelFormat = format;
+        width = fmt.fmt.pix.width;
+        height = fmt.fmt.pix.height;
+        bytesPerLine = fmt.fmt.pix.bytesperline;
+        break;
+    }
+
+    if(pixelFormat == 0) {
+        cout << device << " : neither MJPEG nor YUYV available" << endl;
+        return false;
+    }
+
+    v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = fps;
+    if(xioctl(fd, VIDIOC_S_PARM, &parm) == 0 && parm.parm.capture.timeperframe.numerator > 0)
+        fps = parm.parm.capture.timeperframe.denominator / parm.parm.capture.timeperframe.numerator;
+
+    cout << device << " : " << (pixelFormat == V4L2_PIX_FMT_MJPEG ? "MJPEG " : pixelFormat == V4L2_PIX_FMT_NV12 ? "NV12 " : "YUYV ")
+         << width << "x" << height << " " << fps << " fps" << endl;
+    return true;
+}
+
+bool V4L2Source::mapBuffers() {
+    v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = bufferCount;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    if(xioctl(fd, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+        cout << device << " : mmap buffers not available" << endl;
+        return false;
+    }
+
+    buffers.resize(req.count);
+    for(unsigned int i = 0; i < req.count; ++i) {
+        v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if(xioctl(fd, VIDIOC_QUERYBUF, &buf) < 0)
+            return false;
+
+        buffers[i].length = buf.length;
+        buffers[i].start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+        if(buffers[i].start == MAP_FAILED) {
+            buffers[i].start = nullptr;
+            return false;
+        }
+
+        requeue(i);
+    }
+    return true;
+}
+
+void V4L2Source::requeue(unsigned int index) {
+    v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    xioctl(fd, VIDIOC_QBUF, &buf);
+}
+
+void V4L2Source::capture() {
+    DecodePool::Format format = DecodePool::MJPEG;
+    if(pixelFormat == V4L2_PIX_FMT_YUYV)
+        format = yuv ? DecodePool::YUYV_RAW : DecodePool::YUYV;
+    else if(pixelFormat == V4L2_PIX_FMT_NV12)
+        format = DecodePool::NV12_RAW;
+
+    while(running) {
+        pollfd p = { fd, POLLIN, 0 };
+        if(poll(&p, 1, 100) <= 0)
+            continue;
+
+        v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if(xioctl(fd, VIDIOC_DQBUF, &buf) < 0)
+            continue;
+
+        // driver timestamp (start of exposure or end of frame, depending on the driver) in the steady_clock time base
+        CaptureTime stamp = std::chrono::steady_clock::now();
+        if((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+            stamp = CaptureTime(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::seconds(buf.timestamp.tv_sec) + std::chrono::microseconds(buf.timestamp.tv_usec)));
+
+        // the buffer goes back to the driver once decoded, or at once when the decoders are busy
+        unsigned int index = buf.index;
+        const uchar* data = (const uchar*) buffers[index].start;
+        if(!pool.submit(format, data, buf.bytesused, width, height, bytesPerLine, stamp, [this, index]{ requeue(index); }))
+            requeue(index);
+    }
+}
+
+GrabResult V4L2Source::grab(cv::Mat& frame) {
+    if(!running)
+        return GRAB_END;
+    // a camera that stops delivering for a while is not the end of the stream
+    return pool.latest(frame, stamp, 1000);
+}
+
+void V4L2Source::release() {
+    running = false;
+    if(thread.joinable())
+        thread.join();
+    // no decoder may still read the mapped buffers
+    pool.stop();
+
+    if(fd >= 0) {
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(fd, VIDIOC_STREAMOFF, &type);
+    }
+
+    for(size_t i = 0; i < buffers.size(); ++i)
+        if(buffers[i].start)
+            munmap(buffers[i].start, buffers[i].length);
+    buffers.clear();
+
+    if(fd >= 0)
+        close(fd);
+    fd = -1;
+}
+
+#else
+
+V4L2Source::V4L2Source(std::string device, int width, int height, int fps, int bufferCount)
+        : device(device), width(width), height(height), fps(fps), bufferCount(bufferCount), yuv(false),
+          fd(-1), pixelFormat(0), bytesPerLine(0), running(false) {}
+
+bool V4L2Source::open() { return false; }
+GrabResult V4L2Source::grab(cv::Mat& frame) { return GRAB_END; }
+void V4L2Source::release() {}
+
+#endif
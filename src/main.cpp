@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <iostream>
 #include <GL/glew.h>
 #include <orbiter.h>
@@ -6,14 +7,38 @@
 #include <draw.h>
 #include <pthread.h>
 #include <Shader.h>
-#include "app.h"
+#include <text.h>
+#include <texture.h>
+#include <state.h>
+#include <LatencyMeter.h>
+#include <Overlay.h>
+#include <DynamicResolution.h>
+#include <Recorder.h>
+#include "app_time.h"
+
+// command line
+struct Options {
+    CamCalibration::TrackingMode trackingMode = CamCalibration::CHESSBOARD;
+    std::string capture;
+    bool yuv = false;
+    bool stats = false;     // tracking statistics on screen
+    bool profile = false;   // cpu and gpu times of each pass on screen
+    bool latency = false;   // motion to photon latency, led probe
+    bool dynamicResolution = false;     // terrain and overlays rendered at a lower resolution when the gpu is too slow
+    float frameBudget = 14.f;           // gpu time per frame, ms, for the dynamic resolution
+    bool headless = false;              // no window, no display : offscreen EGL context, cf lib/headless.h
+    int frames = 0;                     // stop after this number of frames, 0 : until closed
+    std::string screenshot;             // image written after the last frame
+    std::string record;                 // session video or image sequence, cf Recorder
+    Pacing pacing = PACING_VSYNC;       // cf lib/app.h
+};
 
 static void* cam(void* arg){
     CamCalibration* c = (CamCalibration*) arg;
     c->start();
 }
 
-class Framebuffer : public App {
+class Framebuffer : public AppTime {
 protected:
     Orbiter m_camera;
     Mire m_mire;
@@ -22,13 +47,22 @@ protected:
     float camSpeed = 10;
     CamCalibration* m_calibration;
     GLuint tex = -1;
+    GLuint texChroma = 0;
+    int yuvFormat = 0;      // cf data/mesh_color.glsl
     Shader s;
     std::vector<Point> m_fausseMire;
     int sizeX = 7;
     int sizeY = 4;
+    Options m_options;
+    LatencyMeter m_latency;
+    Overlay m_overlay;
+    DynamicResolution m_resolution;
+    Recorder m_recorder;
+    int m_frames = 0;
+    float m_statsDumped = 0;    // last summary written to the terminal, ms, when there is no console
 public:
     // constructeur : donner les dimensions de l'image, et eventuellement la version d'openGL.
-    Framebuffer() : App(640, 480), m_mire(4, 7, SQUARESIZE, Identity()), backGround(GL_TRIANGLE_STRIP) {}
+    Framebuffer(const Options& options = Options()) : AppTime(CAPTURE_WIDTH, CAPTURE_HEIGHT, 3, 3, options.headless), m_mire(4, 7, SQUARESIZE, Identity()), backGround(GL_TRIANGLE_STRIP), m_options(options) {}
 
     void moveCam(){
         int mx, my;
@@ -49,6 +83,14 @@ public:
 
     void camInit(){
         m_calibration = new CamCalibration();
+        m_calibration->setTrackingMode(m_options.trackingMode);
+        m_calibration->setCapture(m_options.capture);
+        m_calibration->setYUV(m_options.yuv);
+        m_calibration->setLatencyProbe(m_options.latency);
+        m_calibration->setPreview(!m_options.headless);
+        if(m_options.pacing == PACING_ON_DEMAND)
+            // redraw when the tracker has a new pose
+            m_calibration->setPublished([]{ wake_events(); });
         pthread_create(&m_threads, NULL, cam, (void*)m_calibration);
 
 //        m_threads.push_back(std::thread(&Framebuffer::panda, this));
@@ -56,8 +98,18 @@ public:
 
     int init() {
 
+        pacing(m_options.pacing);
+        // the console needs data/font.png and data/shaders/text.glsl, without them AppTime writes the profiler to the terminal
+        show_console(m_options.profile || m_options.stats || m_options.latency || m_options.dynamicResolution || !m_options.record.empty());
         camInit();
         s = Shader("data/mesh_color.glsl", 3);
+        m_overlay.init();
+        if(m_options.dynamicResolution)
+            m_resolution.init(window_width(), window_height(), m_options.frameBudget);
+        if(!m_options.record.empty())
+            m_recorder.start(m_options.record, window_width(), window_height(), CAPTURE_FPS);
+        if(m_options.latency)
+            m_latency.init();
 
         m_fausseMire.resize((sizeX + 2) * (sizeY + 2));
 
@@ -67,7 +119,7 @@ public:
 
         glClearColor(0.2, 0.2, 0.2, 1.f);
         glDepthFunc(GL_ALWAYS);
-        glEnable(GL_DEPTH_TEST);
+        state_enable(GL_DEPTH_TEST);
         glFrontFace(GL_CCW);
         return 0;   // ras, pas d'erreur
     }
@@ -75,7 +127,18 @@ public:
     // destruction des objets de l'application
     int quit() {
 
+        m_calibration->stop();
         pthread_join(m_threads,NULL);
+        m_recorder.stop();
+        m_overlay.release();
+        if(m_options.dynamicResolution)
+            m_resolution.release();
+        if(m_options.stats)
+            m_calibration->getStats().dump(std::cout);
+        if(m_options.latency){
+            m_latency.dump(std::cout);
+            m_latency.release();
+        }
         return 0;
     }
 
@@ -87,7 +150,7 @@ public:
         glGenTextures(1, &textureID);
 
         // Bind to our texture handle
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        state_bind_texture(0, textureID);
 
         // Catch silly-mistake texture interpolation method for magnification
         if (magFilter == GL_LINEAR_MIPMAP_LINEAR  ||
@@ -146,15 +209,38 @@ public:
 
         glGenTextures(1, &tex);                  // Create The Texture
 
-        glBindTexture(GL_TEXTURE_2D, tex);
+        state_bind_texture(0, tex);
         glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
         glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
         glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S , GL_REPEAT );
         glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
 
+        if(!img.empty() && img.type() != CV_8UC3){
+            // native camera planes, converted to rgb by the shader
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            if(img.type() == CV_8UC2){
+                // YUYV : 2 bytes per pixel
+                yuvFormat = 1;
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, img.cols, img.rows, 0, GL_RG, GL_UNSIGNED_BYTE, img.data);
+            }
+            else{
+                // NV12 : full size luma plane then a half size interleaved uv plane, 1.5 bytes per pixel
+                yuvFormat = 2;
+                int height = img.rows * 2 / 3;
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, img.cols, height, 0, GL_RED, GL_UNSIGNED_BYTE, img.data);
+
+                glGenTextures(1, &texChroma);
+                state_bind_texture(1, texChroma);
+                glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+                glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, img.cols / 2, height / 2, 0, GL_RG, GL_UNSIGNED_BYTE, img.ptr(height));
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            return;
+        }
+
+        yuvFormat = 0;
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, window_width(), window_height(), 0, GL_BGR, GL_UNSIGNED_BYTE, img.data);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, tex);
         glGenerateMipmap(GL_TEXTURE_2D);
     }
 
@@ -163,13 +249,16 @@ public:
         const Transform VpPVM = Viewport(window_width(), window_height()) * m_calibration->getProjection() * m_calibration->getView() * m_calibration->getTransform();
         const Point magicWand = m_calibration->getMagicWand();
 
+        // markers drawn over the camera image, by the gpu
+        m_overlay.clear();
+        if(m_calibration->hasMagicWand())
+            m_overlay.marker(magicWand, 5, Red());
+
         int cpt = 0;
         for(Point p : m_fausseMire){
 //        Point p = m_fausseMire[4];
             Point pTransform = VpPVM(p);
-
-            cv::Mat img = m_calibration->getMat();
-            cv::rectangle(img, cv::Point(pTransform.x-5, pTransform.y-5), cv::Point(pTransform.x+5, pTransform.y+5), cv::Scalar(0,255,0), 1, 8, 0);
+            m_overlay.marker(pTransform, 5, Green());
 
             if(distance(pTransform, magicWand) <= 15.f){
 //
@@ -183,10 +272,13 @@ public:
         cpt++;
         }
 
+        m_overlay.draw(window_width(), window_height());
     }
 
     // dessiner une nouvelle image
     int render() {
+        CaptureTime started = std::chrono::steady_clock::now();
+        PoseInfo pose = m_calibration->getPoseInfo();   // camera image and pose drawn by this frame
         moveCam();
 
         cv::Mat t = m_calibration->gettVec();
@@ -200,30 +292,145 @@ public:
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         if(key_state(' '))
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            state_polygon_mode(GL_LINE);
         else
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            state_polygon_mode(GL_FILL);
 
-        genTexture();
-        doThings();
+        {
+            ProfilerScope scope(m_profiler, "upload");
+            genTexture();
+        }
+        {
+            ProfilerScope scope(m_profiler, "background");
+            s.draw(m_calibration->getView(), m_calibration->getProjection(), tex, texChroma, yuvFormat);
+        }
 
-        s.draw(m_calibration->getView(), m_calibration->getProjection(), tex);
-        if(flag)
+        if(m_options.dynamicResolution){
+            m_resolution.update(m_profiler.frame_gpu());
+            m_resolution.begin();
+        }
+        if(flag){
+            ProfilerScope scope(m_profiler, "terrain");
             draw(m_mire, m_calibration->getTransform(), m_calibration->getView(), m_calibration->getProjection());
+        }
+        {
+            ProfilerScope scope(m_profiler, "overlay");
+            doThings();
+        }
+        if(m_options.dynamicResolution){
+            ProfilerScope scope(m_profiler, "composite");
+            m_resolution.end();
+        }
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glDeleteTextures(1, &tex);
+        if(m_options.latency){
+            // flashes with the led seen by the camera : film the led and the screen, cf latency
+            float lit = m_calibration->getProbe() ? 1.f : 0.f;
+            state_enable(GL_SCISSOR_TEST);
+            glScissor(window_width() - 64, window_height() - 64, 64, 64);
+            glClearColor(lit, lit, lit, 1.f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            state_disable(GL_SCISSOR_TEST);
+            glClearColor(0.2, 0.2, 0.2, 1.f);
+        }
+
+        // the console is drawn by AppTime, with the profiler
+        if(m_options.stats){
+            if(console_ready())
+                m_calibration->getStats().print(m_console, 0, 0);
+            else if(global_time() - m_statsDumped > 5000){
+                // no font or text shader : the summary goes to the terminal every 5s
+                m_calibration->getStats().dump(std::cout);
+                m_statsDumped = global_time();
+            }
+        }
+        if(m_options.latency)
+            m_latency.print(m_console, 0, 10);
+        if(m_options.dynamicResolution)
+            m_resolution.print(m_console, 0, 16);
+        if(m_recorder.recording())
+            m_recorder.print(m_console, 0, 17);
+        if(key_state('d')){
+            clear_key_state('d');
+            m_calibration->getStats().dump(std::cout);
+        }
+
+        state_delete_textures(1, &tex);
+        if(texChroma){
+            state_delete_textures(1, &texChroma);
+            texChroma = 0;
+        }
+
+        if(m_options.latency)
+            m_latency.rendered(pose.frame, pose.captured, started);
+        m_recorder.frame();
+
+        if(m_options.frames > 0 && ++m_frames >= m_options.frames){
+            if(!m_options.screenshot.empty())
+                screenshot(m_options.screenshot.c_str());
+            return 0;
+        }
         return 1;
     }
 
+    void presented() {
+        if(m_options.latency)
+            m_latency.presented();
+    }
+
 };
 
 
 int main(int argc, char **argv) {
 
-    Framebuffer tp;
-    tp.run();
+    Options options;
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "--markers")
+            options.trackingMode = CamCalibration::MARKER_BOARD;
+        else if(arg == "--capture" && i + 1 < argc)
+            options.capture = argv[++i];
+        else if(arg == "--yuv")
+            options.yuv = true;
+        else if(arg == "--stats")
+            options.stats = true;
+        else if(arg == "--profile")
+            options.profile = true;
+        else if(arg == "--latency")
+            options.latency = true;
+        else if(arg == "--dynamic-resolution")
+            options.dynamicResolution = true;
+        else if(arg == "--frame-budget" && i + 1 < argc)
+            options.frameBudget = (float) atof(argv[++i]);
+        else if(arg == "--headless")
+            options.headless = true;
+        else if(arg == "--frames" && i + 1 < argc)
+            options.frames = atoi(argv[++i]);
+        else if(arg == "--screenshot" && i + 1 < argc)
+            options.screenshot = argv[++i];
+        else if(arg == "--record" && i + 1 < argc)
+            options.record = argv[++i];
+        else if(arg == "--pacing" && i + 1 < argc){
+            std::string mode = argv[++i];
+            if(mode == "low-latency")
+                options.pacing = PACING_LOW_LATENCY;
+            else if(mode == "on-demand")
+                options.pacing = PACING_ON_DEMAND;
+            else if(mode == "uncapped")
+                options.pacing = PACING_UNCAPPED;
+            else if(mode == "vsync")
+                options.pacing = PACING_VSYNC;
+            else {
+                std::cerr << "unknown pacing mode '" << mode << "', expected vsync, low-latency, on-demand or uncapped" << std::endl;
+                return 1;
+            }
+        }
+        else if(arg == "--marker-board" && i + 1 < argc)
+            return CamCalibration::writeMarkerBoard(argv[++i]) ? 0 : 1;
+    }
+
+    Framebuffer tp(options);
+    if(tp.run() < 0)
+        return 1;
 
 //    CamCalibration c;
 //    c.start();